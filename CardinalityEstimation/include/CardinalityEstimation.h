@@ -1,27 +1,356 @@
 #ifndef CARDINALITY_ESTIMATION_H
 #define CARDINALITY_ESTIMATION_H
 
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <tuple>
 #include <vector>
+#include <common/Expression.h>
+#include <engine/ThetaSketch.h>
+#include <executer/DataExecuter.h>
+
+// Bytes held by one engine, by component
+struct CEMemoryUsage {
+    size_t sample = 0;          // reservoir sample of inserted tuples
+    size_t distinctSketch = 0;  // engine-wide pair sketch and worker shards
+    size_t columnCounts = 0;    // per-column Count-Min counters
+    size_t blockSummaries = 0;  // per-block zone maps, sketches and histograms
+    size_t buffers = 0;         // batch hashing scratch space
+    size_t groupSketches = 0;   // per-group distinct counters (CEConfig::groupedDistinct)
+
+    size_t total() const {
+        return sample + distinctSketch + columnCounts + blockSummaries + buffers + groupSketches;
+    }
+};
+
+// Memory cap shared by every engine whose CEConfig::memoryBudget points at it. Engines report their usage every few
+// thousand applied tuples. When the total is over the limit, engines above their fair share (limit / engines) free
+// the excess, the largest first: idle engines are asked to shrink if they are not busy, and the reporting engine
+// covers whatever is left of its part. An engine frees memory cheapest loss first: scratch buffers, lossless
+// re-encoding of sketches (sparse or 6-bit packed registers), then alternately halving its tuple sample and lowering
+// sketch precision (pair sketch registers down to 2^10, Count-Min width down to 256). Thread-safe.
+class CEMemoryBudget {
+public:
+    // Try to free wantedBytes; returns false without doing anything if the engine is busy, otherwise true with the
+    // engine's usage afterwards in usage
+    using Reclaim = std::function<bool(size_t wantedBytes, CEMemoryUsage& usage)>;
+
+    explicit CEMemoryBudget(size_t limitBytes);
+
+    size_t limit() const { return limitBytes; }
+
+    // Sum of the latest reports of every registered engine
+    size_t used() const;
+
+    // Latest report of every registered engine
+    std::vector<CEMemoryUsage> usage() const;
+
+    // Called by CEEngine: attach() registers an engine and returns its id, report() records its usage, asks other
+    // engines over their share to shrink, and returns how many bytes the reporting engine should free itself (0
+    // while the budget holds). reclaim is never called for the engine that is reporting.
+    uint64_t attach(Reclaim reclaim);
+    void detach(uint64_t engineId);
+    size_t report(uint64_t engineId, const CEMemoryUsage& usage);
+
+private:
+    const size_t limitBytes;
+    mutable std::mutex budgetMutex;
+    struct Member {
+        CEMemoryUsage usage;
+        Reclaim reclaim;
+    };
+    std::map<uint64_t, Member> members;
+    uint64_t nextEngineId = 1;
+    size_t totalBytes = 0;
+};
+
+// Tuning knobs for a CEEngine instance
+struct CEConfig {
+    // Maximum number of submitted batches waiting to be applied before submit() blocks
+    size_t ingestQueueCapacity = 8;
+    // Worker threads used to split large batches; 1 keeps every update on the calling thread
+    int numThreads = 1;
+    // Pin workers round-robin to NUMA nodes and give each one a sketch shard allocated on its own node; shards are
+    // merged only when estimating. Requires numThreads > 1.
+    bool numaSharding = false;
+    // Publish a new snapshot after this many applied tuples (0 = only on publish() and prepare())
+    size_t snapshotInterval = 65536;
+    // Resync I/O budget in tuples read per second (0 = unlimited)
+    double resyncTuplesPerSecond = 0;
+    // Resync CPU budget: share of wall time the rescan may spend working, in (0, 1]
+    double resyncCpuFraction = 1.0;
+    // Pause between background resyncs started with startResync()
+    int resyncIntervalMs = 60000;
+    // With CE_LATENCY_STATS, time one of every this many calls of each operation per thread (rounded up to a power
+    // of two).
+    // Each timed call costs two timestamp-counter reads; sampling keeps the average cost to a few nanoseconds.
+    uint32_t latencySampleInterval = 1;
+    // Tuples kept in the engine's uniform random sample of inserts (see CEEngine::sample)
+    size_t sampleCapacity = 65536;
+    // Hashes kept by the engine's k-minimum-values sketch for estimateOverlap (0 = don't keep one). Costs 8 bytes per
+    // hash; the relative error of the union is about 1 / sqrt(overlapSketchSize).
+    size_t overlapSketchSize = 2048;
+    // Count distinct column 1 values per column 0 value (estimateGroupDistinct). Groups share two arenas: small groups
+    // take about 4 bytes per distinct value, and only groups past 2^14 / 4 of them get 16KB of registers.
+    bool groupedDistinct = false;
+    // Query feedback waiting to be trained on (see CEEngine::recordFeedback); more is dropped. 0 ignores feedback.
+    size_t feedbackQueueCapacity = 4096;
+    // Shared memory cap, or null for none. The budget must outlive the engine.
+    std::shared_ptr<CEMemoryBudget> memoryBudget;
+};
+
+// Public calls timed when the library is built with CE_LATENCY_STATS
+enum class CEOperation {
+    INSERT_TUPLE, INSERT_TUPLES, DELETE_TUPLE, DELETE_TUPLES, ESTIMATE, ESTIMATE_FREQUENCY, QUERY, ESTIMATE_JOIN, ESTIMATE_OVERLAP
+};
+
+// Latency distribution of one operation. Percentiles are upper bounds of log-spaced buckets (within 12.5%).
+struct CELatency {
+    uint64_t count = 0;
+    double p50Nanos = 0;
+    double p99Nanos = 0;
+    double p999Nanos = 0;
+    double maxNanos = 0;
+};
+
+// Estimated size of an equi-join between a column of two engines (see CEEngine::estimateJoin). N and M are the two
+// engines' live tuple counts and w the Count-Min width.
+struct CEJoinEstimate {
+    // Expected-collision-corrected estimate: the median over counter rows of (product - N * M / w) / (1 - 1 / w)
+    double estimate = 0;
+    // Smallest row product; never below the true size while no column value has more deletes than inserts
+    double upperBound = 0;
+    // upperBound exceeds the true size by at most e / w * N * M, with probability at least 1 - e^-depth
+    double maxOvercount = 0;
+};
+
+// Estimated sizes of the parts of two engines' distinct tuple sets A and B (see CEEngine::estimateOverlap)
+struct CEOverlap {
+    double intersection = 0;  // |A ∩ B|
+    double leftOnly = 0;      // |A \ B|
+    double rightOnly = 0;     // |B \ A|
+    double unionSize = 0;     // |A ∪ B|
+};
+
+// An estimate with the interval the true value is expected in (see CEEngine::estimateWithBounds,
+// estimateFrequencyWithBounds and queryWithBounds). Bounds come from state the engine keeps anyway, at about the cost
+// of the estimate itself.
+struct CEBounds {
+    double estimate = 0;
+    double lower = 0;
+    double upper = 0;
+    // Probability that the interval holds the true value; 1 for bounds that always hold
+    double confidence = 1;
+};
+
+// Block summaries and column counters frozen at publication, for query() and queryWithBounds(); defined by the engine
+struct CEQuerySummaries;
+
+// What a query's estimate was built from, filled in by query() and queryWithBounds() for a later recordFeedback, so
+// training never has to recompute it
+struct CEQueryTrace {
+    double uncorrected = 0;   // block summaries' estimate, before the feedback correction
+    int cell = -1;            // SelectivityModel cell of the quals; -1 until a query fills the trace in
+    uint64_t generation = 0;  // engine state the query ran against; reports from before a prepare() are dropped
+};
+
+// Immutable point-in-time view of an engine. Values are computed when the snapshot is published, so reading them
+// costs nothing and never waits for ingest.
+class CESnapshot {
+public:
+    CESnapshot(uint64_t version, double estimate, size_t tupleCount,
+               std::shared_ptr<const CEQuerySummaries> summaries = nullptr);
+
+    // Publication counter, increasing with every publish
+    uint64_t version() const { return snapshotVersion; }
+
+    // Cardinality estimate as of publication
+    double estimate() const { return cachedEstimate; }
+
+    // Live tuples (inserts minus deletes) as of publication
+    size_t tupleCount() const { return numTuples; }
+
+    // What query() reads; opaque outside the engine
+    const std::shared_ptr<const CEQuerySummaries>& summaries() const { return querySummaries; }
+
+private:
+    const uint64_t snapshotVersion;
+    const double cachedEstimate;
+    const size_t numTuples;
+    const std::shared_ptr<const CEQuerySummaries> querySummaries;
+};
 
 class CEEngine {
 public:
     CEEngine();
+    explicit CEEngine(const CEConfig& config);
+    // Attach the engine to base data of num tuples. prepare() loads it through executer->readTuples, inserted
+    // tuples are assumed to be appended (ids num, num + 1, ...), and resync() rescans it.
+    CEEngine(int num, DataExecuter* executer, const CEConfig& config = CEConfig());
     ~CEEngine();
 
     // Insert a new tuple
     void insertTuple(const std::tuple<int, int>& tuple);
 
+    // Insert a batch of tuples; large batches are split across config.numThreads workers
+    void insertTuples(const std::vector<std::tuple<int, int>>& batch);
+
+    // Remove one previously inserted tuple
+    void deleteTuple(const std::tuple<int, int>& tuple);
+
+    // Remove a batch of previously inserted tuples. Per-column counters are decremented in bulk (split across
+    // config.numThreads workers for large batches). The distinct-count sketch can only forget deleted values while
+    // it is still counting exactly; after that estimate() stays an upper bound.
+    void deleteTuples(const std::vector<std::tuple<int, int>>& batch);
+
+    // Deletes that also pass the executer's tuple ids. The id locates the tuple's block, so a later resync only
+    // rescans blocks that saw deletes; a delete without an id makes the next resync rescan every block.
+    void deleteTuple(const std::tuple<int, int>& tuple, int tupleId);
+    void deleteTuples(const std::vector<std::tuple<int, int>>& batch, const std::vector<int>& tupleIds);
+
+    // Queue a batch for insertion on the engine's ingest thread. The batch is moved, not copied, and the call
+    // blocks while the ingest queue is full. The returned future becomes ready once the batch has been applied.
+    std::future<void> submit(std::vector<std::tuple<int, int>> batch);
+
+    // Non-blocking submit: returns false and leaves the batch untouched when the ingest queue is full
+    bool trySubmit(std::vector<std::tuple<int, int>>& batch, std::future<void>& done);
+
+    // Wait until every submitted batch has been applied
+    void flush();
+
     // Estimate current cardinality
     double estimate();
 
-    // Prepare/reset the engine
+    // estimate() plus or minus numStdDevs standard errors of the distinct sketch (1.04 / sqrt(2^14) relative at the
+    // default precision, larger after the memory budget folds it), with the matching normal confidence. Exact, with
+    // equal bounds, while the sketch still counts in its hash map.
+    CEBounds estimateWithBounds(double numStdDevs = 2);
+
+    // Estimated number of live tuples whose column columnIdx equals value (never an underestimate)
+    double estimateFrequency(int columnIdx, int value);
+
+    // estimateFrequency() as the upper bound, and the Count-Min guarantee below it: the true count is at least the
+    // estimate minus e / width * live tuples with probability 1 - e^-depth
+    CEBounds estimateFrequencyWithBounds(int columnIdx, int value);
+
+    // Size of the equi-join of this engine's column columnIdx with other's column otherColumnIdx (other may be this
+    // engine), from the inner product of the two columns' Count-Min counters. Costs one pass over the counters (a few
+    // microseconds at the default 4 x 2048); see CEJoinEstimate for the error bounds.
+    CEJoinEstimate estimateJoin(int columnIdx, const CEEngine& other, int otherColumnIdx);
+
+    // Distinct tuples shared by this engine and other, and held by only one of them, from the two engines'
+    // k-minimum-values sketches (CEConfig::overlapSketchSize; all zeros if either engine keeps none). Exact while
+    // both engines have seen fewer than overlapSketchSize distinct tuples. The error of each part is about
+    // sqrt(part * union) / sqrt(k), so unlike inclusion-exclusion on estimate() a small overlap stays measurable.
+    // Deletes are not subtracted.
+    CEOverlap estimateOverlap(const CEEngine& other);
+
+    // Distinct column 1 values among tuples whose column 0 is group (0 for an unseen group or without
+    // CEConfig::groupedDistinct), number of groups seen, and every group with its estimate. Like estimate(), the
+    // counts do not drop on deletes.
+    double estimateGroupDistinct(int group);
+    size_t groupCount();
+    void forEachGroup(const std::function<void(int group, double distinct)>& fn);
+
+    // Copy of the engine's k-minimum-values sketch as a theta sketch (empty if CEConfig::overlapSketchSize is 0), to
+    // combine with other engines' sketches through ThetaSketch's set operations
+    ThetaSketch thetaSketch();
+
+    // Latest published snapshot. Never takes the engine lock, so it is safe to call from any thread while other
+    // threads insert.
+    std::shared_ptr<const CESnapshot> snapshot() const;
+
+    // Publish a snapshot of the current state now
+    void publish();
+
+    // Estimated number of live tuples matching every qual, from per-block summaries of 2^16 consecutive tuple ids
+    // (zone maps, distinct counts and value histograms). Blocks whose zone maps rule a qual out cost nothing.
+    // Reads the latest published snapshot, which shares the block summaries with the engine until they change, so
+    // it never takes the engine lock; writes since the last publication are not visible yet (call publish() first
+    // to see them).
+    int query(const std::vector<CompareExpression>& quals, CEQueryTrace* trace = nullptr);
+
+    // query() with the range the answer lies in regardless of how the quals correlate: per block, each qual's count
+    // is known up to the rows of the one histogram bucket its value falls in, and those per-qual ranges bound the
+    // conjunction (Frechet bounds). An equality also caps the range at its Count-Min frequency, and a single
+    // equality raises the floor toward the Count-Min lower bound, up to the estimate (confidence 1 - e^-depth;
+    // otherwise 1). Deletes without a tuple id lower the floor by their number until a resync.
+    CEBounds queryWithBounds(const std::vector<CompareExpression>& quals, CEQueryTrace* trace = nullptr);
+
+    // Report the true number of rows matching a query, e.g. counted by the executor after running it, with the
+    // trace the query filled in. A background thread folds feedback into a residual grid (SelectivityModel) over
+    // each column's operator and estimated selectivity, and publishes it for query() and queryWithBounds() to scale
+    // their estimates by, within what the block summaries can rule out. Applying it costs a table lookup. The trace
+    // carries the estimate to train against, so training never takes the engine lock. Never waits for training;
+    // returns false when the trace was never filled in, comes from before the last prepare() (which discards the
+    // model), or CEConfig::feedbackQueueCapacity reports are already waiting.
+    bool recordFeedback(const CEQueryTrace& trace, int trueCount);
+
+    // Wait until every recorded report is part of the published model
+    void flushFeedback();
+
+    // Reports the published model was trained on
+    uint64_t feedbackSamples() const;
+
+    // Rebuild the summaries of every block that saw deletes from the executer's live tuples, one block at a time
+    // within the CEConfig resync budget, and swap each in without stopping ingest. Bounds the drift deletes leave
+    // behind. Runs on the calling thread and returns false when no executer is attached, another resync is running,
+    // or some block could not be rebuilt (changed while being read, or cancelled).
+    bool resync();
+
+    // Run resync() every config.resyncIntervalMs on a background thread. The executer's readTuples must then be
+    // safe to call while the caller keeps updating the executer.
+    void startResync();
+    void stopResync();
+
+    // Prepare/reset the engine. Precision lost to the memory budget stays lost.
     void prepare();
 
+    // Bytes currently held, by component
+    CEMemoryUsage memoryUsage() const;
+
+    // Uniform random sample of every tuple inserted since prepare(), at most config.sampleCapacity tuples (fewer once
+    // the memory budget has shrunk it). Deletes do not remove tuples from the sample.
+    std::vector<std::tuple<int, int>> sample() const;
+
+    // Latency of every call of op so far, merged across calling threads. All zeros unless the library was built with
+    // -DCE_LATENCY_STATS=ON; recording costs a few nanoseconds per call and never takes a lock.
+    CELatency latency(CEOperation op) const;
+    void resetLatency();
+
 private:
     class Impl;
     std::unique_ptr<Impl> pImpl;
 };
 
-#endif // CARDINALITY_ESTIMATION_H
\ No newline at end of file
+// Recycles engines for short-lived use, e.g. one per intermediate result in a planner. release() resets an engine
+// with prepare(), which keeps its sketch, block and sample storage, so an engine acquired from a warm pool and
+// filled with a similar amount of data does not allocate again. Not thread-safe: keep one pool per thread; local()
+// is the calling thread's pool of default-configured engines.
+class CEEnginePool {
+public:
+    explicit CEEnginePool(const CEConfig& config = CEConfig(), size_t maxIdle = 16);
+
+    // An empty engine with the pool's config: a recycled one when any is idle, otherwise a new one
+    std::unique_ptr<CEEngine> acquire();
+
+    // Reset an engine from acquire() and keep it for reuse, or destroy it when maxIdle engines are already idle
+    void release(std::unique_ptr<CEEngine> engine);
+
+    // Engines waiting to be reused
+    size_t idle() const { return engines.size(); }
+
+    static CEEnginePool& local();
+
+private:
+    const CEConfig config;
+    const size_t maxIdle;
+    std::vector<std::unique_ptr<CEEngine>> engines;
+};
+
+#endif // CARDINALITY_ESTIMATION_H
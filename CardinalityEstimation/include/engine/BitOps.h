@@ -0,0 +1,57 @@
+#ifndef CARDINALITYESTIMATION_BITOPS
+#define CARDINALITYESTIMATION_BITOPS
+//
+// Bit counting on 64-bit words: compiler builtins on GCC and Clang, plain loops elsewhere
+//
+
+#include <cstdint>
+
+// Count leading zeros in a 64-bit integer
+inline int countLeadingZeros(uint64_t x) {
+    if (x == 0) return 64;
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_clzll(x);
+#else
+    int count = 0;
+    // Start from the most significant bit
+    uint64_t mask = UINT64_C(1) << 63;
+    
+    while ((x & mask) == 0) {
+        count++;
+        mask >>= 1;
+    }
+    
+    return count;
+#endif
+}
+
+// Count trailing zeros in a 64-bit integer
+inline int countTrailingZeros(uint64_t x) {
+    if (x == 0) return 64;
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(x);
+#else
+    int count = 0;
+    while ((x & 1) == 0) {
+        count++;
+        x >>= 1;
+    }
+    return count;
+#endif
+}
+
+// Number of set bits in a 64-bit integer
+inline int popCount(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(x);
+#else
+    int count = 0;
+    // Each step clears the lowest set bit
+    for (; x != 0; x &= x - 1) {
+        count++;
+    }
+    return count;
+#endif
+}
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef CARDINALITYESTIMATION_BLOCKSUMMARY
+#define CARDINALITYESTIMATION_BLOCKSUMMARY
+//
+// Summaries of one block of 2^kBlockBits consecutive tuple ids. Per column: a zone map (min/max), a small
+// HyperLogLog and a log-bucketed histogram. Per block: the live row count and a pair sketch at the engine's
+// precision, so the engine-wide distinct count can be rebuilt by merging blocks. Deletes and resyncs only touch the
+// blocks their tuple ids fall into.
+//
+
+#include "engine/HyperLogLog.h"
+#include <common/Expression.h>
+#include <array>
+#include <climits>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+// Histogram over the whole int range with fixed buckets: exact below 8 in magnitude, then 8 buckets per power of
+// two. Every block uses the same boundaries, so histograms can be compared and added bucket by bucket.
+class LogHistogram {
+public:
+    static const int kBuckets = 512;
+
+    static int bucketOf(int value);
+    // Inclusive value range of a bucket
+    static int64_t bucketLow(int bucket);
+    static int64_t bucketHigh(int bucket);
+
+    void add(int value, int32_t delta) { counts[bucketOf(value)] += delta; }
+    int32_t count(int bucket) const { return counts[bucket]; }
+
+    // Estimated number of counted values greater than value, interpolating linearly inside the bucket holding
+    // value. Bucket ranges are clipped to [lo, hi], the zone map of the data.
+    double countGreater(int value, int lo, int hi) const;
+
+    // Range the true number of values greater than value lies in: the interpolation in countGreater is the only
+    // guess, so the two differ by at most the rows of value's bucket
+    void countGreaterBounds(int value, int lo, int hi, double& lower, double& upper) const;
+
+    void reset() { counts.fill(0); }
+
+private:
+    // Counted values in the buckets after bucket
+    double countAbove(int bucket) const;
+
+    std::array<int32_t, kBuckets> counts{};
+};
+
+struct ColumnSummary {
+    int minValue = INT_MAX;  // zone map; widened by inserts, only narrowed by a rebuild
+    int maxValue = INT_MIN;
+    HyperLogLog distinct;
+    LogHistogram histogram;
+
+    ColumnSummary() : distinct(10, false) {}
+
+    // Estimated live rows equal to / greater than value among liveRows
+    double countEqual(int value, int64_t liveRows) const;
+    double countGreater(int value) const;
+    // Ranges the true counts lie in, from the histogram alone
+    void equalBounds(int value, double& lower, double& upper) const;
+    void greaterBounds(int value, double& lower, double& upper) const;
+};
+
+class BlockSummary {
+public:
+    static const int kBlockBits = 16;
+    static const int kNumColumns = 2;
+
+    explicit BlockSummary(int pairPrecision);
+
+    // Hashes are computed once per tuple by the caller and shared with the engine-wide summaries
+    void insert(const std::tuple<int, int>& tuple, uint64_t pairHash, const uint64_t* columnHashes);
+
+    // Deletes adjust counts only; zone maps and sketches keep the value until the block is rebuilt
+    void remove(const std::tuple<int, int>& tuple);
+
+    // Estimated live rows satisfying every qual (quals treated as independent within the block). With qualCounts,
+    // also adds the estimated rows matching each qual alone to qualCounts[i].
+    double estimateMatches(const std::vector<CompareExpression>& quals, double* qualCounts = nullptr) const;
+
+    // Range the live rows satisfying every qual lie in, whatever the correlation between quals; always contains
+    // estimateMatches
+    void matchBounds(const std::vector<CompareExpression>& quals, double& lower, double& upper) const;
+
+    // Bytes held by the block's summaries
+    size_t memoryUsage() const;
+
+    // Re-encode the block's sketches in their smallest form (see HyperLogLog::compact). Returns the bytes freed.
+    size_t compact();
+
+    // Empty the block for reuse, keeping its storage
+    void reset();
+
+    // Fold the pair sketch down to 2^bits registers
+    void downgradePairs(int bits) { pairs.downgrade(bits); }
+
+    int64_t liveRows() const { return numLive; }
+    const HyperLogLog& pairSketch() const { return pairs; }
+    const ColumnSummary& column(int columnIdx) const { return columns[columnIdx]; }
+
+    // Bumped by every insert or delete, so a rebuild can tell whether the block changed while it was being read
+    uint64_t version = 0;
+    // Deletes since the block was last built; a block with none has no drift to repair
+    int64_t deletesSinceBuild = 0;
+
+private:
+    HyperLogLog pairs;
+    ColumnSummary columns[kNumColumns];
+    int64_t numLive = 0;
+};
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef CARDINALITYESTIMATION_COUNTMINSKETCH
+#define CARDINALITYESTIMATION_COUNTMINSKETCH
+//
+// Count-Min sketch with signed counters, so deletes can be applied as negative updates. Each key is hashed once; the
+// per-row column is derived from that hash by double hashing. Batch updates hash every key first and then walk one
+// counter row at a time, which keeps the row being written in L1 and lets independent rows be updated in parallel.
+// Counters are cleared lazily in 64-byte blocks, so reset() only clears a bitmap.
+//
+
+#include "engine/DirtyBlocks.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class CountMinSketch {
+public:
+    CountMinSketch(int depth = 4, int widthBits = 11);
+
+    static uint64_t hash(uint64_t key);
+
+    void add(uint64_t key, int32_t delta);
+
+    // Apply delta for a key already passed through hash()
+    void addHashed(uint64_t hash, int32_t delta);
+
+    // Apply the same delta to every key
+    void addBatch(const uint64_t* keys, size_t n, int32_t delta);
+
+    // Apply delta to a single row for already hashed keys. Different rows may be updated concurrently.
+    void addHashedRow(int row, const uint64_t* hashes, size_t n, int32_t delta);
+
+    // Account for n updates of delta made through addHashedRow
+    void addToTotal(int64_t amount) { totalCount += amount; }
+
+    // Upper-biased frequency estimate (never below the true count while counts stay non-negative)
+    int64_t estimate(uint64_t key) const;
+
+    // Sum of all applied deltas
+    int64_t total() const { return totalCount; }
+
+    // e / width * total(): with probability at least 1 - e^-depth, estimate(key) exceeds the true count by at most
+    // this (Cormode and Muthukrishnan 2005)
+    double maxOvercount() const;
+
+    int depth() const { return rows; }
+    size_t width() const { return size_t(1) << widthBits; }
+    int widthLog2() const { return widthBits; }
+
+    // Dot product of each counter row with the same row of other, for the rows both sketches have. Both sketches
+    // hash keys the same way, so row r's product is the sum over keys of the two counts plus the products of keys
+    // sharing a column; it never underestimates while counts are non-negative. A wider sketch is folded to the
+    // narrower width first (see shrinkWidth), so sketches of different widths can be combined.
+    std::vector<double> rowInnerProducts(const CountMinSketch& other) const;
+
+    // Halve the width until it is 2^bits, adding the upper half of every row onto the lower half. Columns are hash
+    // bits masked by the width, so the result is the sketch a narrower width would have built (error grows ~2x
+    // per halving). No-op unless bits is below the current width.
+    void shrinkWidth(int bits);
+
+    // Bytes held by the sketch, including its counters
+    size_t memoryUsage() const {
+        return sizeof(*this) + counters.capacity() * sizeof(int32_t) + touched.memoryUsage();
+    }
+
+    void reset();
+
+private:
+    static const int kBlockShift = 4;  // 16 counters per block
+
+    // Counter at index i, made writable: a clean block holds stale values and is zeroed on its first write
+    int32_t& counterAt(size_t i) {
+        if (!touched.dirty(i >> kBlockShift)) {
+            zeroBlock(i >> kBlockShift);
+        }
+        return counters[i];
+    }
+    int32_t counterValue(size_t i) const { return touched.dirty(i >> kBlockShift) ? counters[i] : 0; }
+    void zeroBlock(size_t block);
+
+    size_t column(uint64_t hash, int row) const {
+        uint32_t h1 = static_cast<uint32_t>(hash);
+        uint32_t h2 = static_cast<uint32_t>(hash >> 32) | 1;
+        return (h1 + static_cast<uint32_t>(row) * h2) & (width() - 1);
+    }
+
+    std::vector<int32_t> counters;  // row-major, depth x width
+    DirtyBlocks touched;
+    const int rows;
+    int widthBits;
+    int64_t totalCount = 0;
+};
+
+#endif
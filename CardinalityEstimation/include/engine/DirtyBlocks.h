@@ -0,0 +1,58 @@
+#ifndef CARDINALITYESTIMATION_DIRTYBLOCKS
+#define CARDINALITYESTIMATION_DIRTYBLOCKS
+//
+// One bit per fixed-size block of an array, set once the block has been written since the last clear(). Owners reset
+// by clearing the bits instead of the array: a block is zeroed on its first write afterwards, and readers treat
+// clean blocks as all zero. With 64-byte blocks, clearing a 256KB array touches 64 words.
+//
+
+#include "engine/BitOps.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class DirtyBlocks {
+public:
+    // Track numBlocks blocks, all clean
+    void assign(size_t numBlocks) { bits.assign((numBlocks + 63) / 64, 0); }
+
+    // Mark the first numBlocks blocks dirty
+    void markFirst(size_t numBlocks) {
+        std::fill(bits.begin(), bits.begin() + numBlocks / 64, ~UINT64_C(0));
+        if (numBlocks % 64 != 0) {
+            bits[numBlocks / 64] |= (UINT64_C(1) << (numBlocks % 64)) - 1;
+        }
+    }
+
+    bool dirty(size_t block) const { return (bits[block >> 6] >> (block & 63)) & 1; }
+
+    void mark(size_t block) { bits[block >> 6] |= UINT64_C(1) << (block & 63); }
+
+    void clear() { std::fill(bits.begin(), bits.end(), 0); }
+
+    // Call fn(block) for every dirty block, in increasing order
+    template <typename Fn>
+    void forEachDirty(Fn fn) const {
+        for (size_t w = 0; w < bits.size(); ++w) {
+            for (uint64_t word = bits[w]; word != 0; word &= word - 1) {
+                fn(w * 64 + static_cast<size_t>(countTrailingZeros(word)));
+            }
+        }
+    }
+
+    size_t countDirty() const {
+        size_t n = 0;
+        for (uint64_t word : bits) {
+            n += static_cast<size_t>(popCount(word));
+        }
+        return n;
+    }
+
+    size_t memoryUsage() const { return bits.capacity() * sizeof(uint64_t); }
+
+private:
+    std::vector<uint64_t> bits;
+};
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef CARDINALITYESTIMATION_GROUPEDDISTINCT
+#define CARDINALITYESTIMATION_GROUPEDDISTINCT
+//
+// Distinct counts of values per group (column 1 per column 0 value, for CEEngine), for millions of groups. Every
+// group is a HyperLogLog at the same precision, but registers are only materialized for groups that need them:
+// a group starts as a short run of sparse (index << 6) | rank pairs in an arena shared by all groups, doubling its
+// run as it fills, and moves to a dense register array in a second arena once its pairs would take as much room as
+// registers. Memory therefore grows with the number of distinct (group, value) pairs, not with groups x 2^p.
+// As in HyperLogLog++ (Heule et al. 2013), sparse pairs use a 25-bit index, so small groups, which are most of
+// them, count by linear counting over 2^25 slots and are all but exact. Group records live in one open-addressing
+// table keyed by group id.
+//
+
+#include "engine/HyperLogLog.h"
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+class GroupedDistinct {
+public:
+    explicit GroupedDistinct(int bits = 14);
+
+    // Hash of a value as CEEngine hashes column values (CountMinSketch::hash), so engine batches can pass the
+    // hashes they already computed
+    static uint64_t hashValue(int value);
+
+    // Count valueHash (from hashValue) in group
+    void add(int group, uint64_t valueHash);
+
+    // Count column 1 of every tuple in the group of its column 0. valueHashes, when given, holds hashValue of every
+    // column 1 value.
+    void addBatch(const std::vector<std::tuple<int, int>>& tuples, const uint64_t* valueHashes = nullptr);
+
+    // Estimated distinct values seen in group (0 for a group never seen)
+    double estimate(int group) const;
+
+    // Call fn(group, estimate) for every group, in no particular order
+    template <typename Fn>
+    void forEachGroup(Fn fn) const {
+        for (const Group& g : table) {
+            if (g.used) {
+                fn(g.key, estimateGroup(g));
+            }
+        }
+    }
+
+    size_t numGroups() const { return numUsed; }
+    // Groups holding dense registers
+    size_t numDense() const { return denseCount; }
+    int precision() const { return registerBits; }
+
+    // Bytes held, including both arenas and the group table
+    size_t memoryUsage() const;
+
+    // Forget every group, keeping the storage
+    void reset();
+
+private:
+    struct Group {
+        int32_t key = 0;
+        bool used = false;
+        bool dense = false;
+        uint8_t sizeClass = 0;  // sparse run holds kMinRun << sizeClass pairs
+        uint32_t size = 0;      // sparse pairs in use; the first sorted of them are sorted and distinct
+        uint32_t sorted = 0;
+        uint32_t offset = 0;    // into sparseArena, or dense group number in denseArena
+    };
+
+    static const uint32_t kMinRun = 4;
+    static const int kSparseBits = 25;
+
+    Group& findOrInsert(int group);
+    const Group* find(int group) const;
+    size_t home(int group) const {
+        uint64_t x = static_cast<uint32_t>(group) * UINT64_C(0x9e3779b97f4a7c15);
+        return static_cast<size_t>(x >> 32) & mask;
+    }
+    void growTable();
+
+    void addToGroup(Group& g, uint64_t valueHash);
+    // Sort and deduplicate a full run, then grow it or promote the group to dense registers
+    void makeRoom(Group& g);
+    uint32_t allocateRun(uint8_t sizeClass);
+    void freeRun(uint8_t sizeClass, uint32_t offset);
+    // Move every live run to the front of a new arena, dropping released runs
+    void compactArena();
+    void promote(Group& g);
+    // Dense register index and rank of a sparse pair
+    void denseRegister(uint32_t pair, uint32_t& idx, uint8_t& rank) const;
+    double estimateGroup(const Group& g) const;
+
+    const int registerBits;
+    const uint8_t maxSizeClass;  // largest sparse run, at which pairs take as much room as registers
+
+    std::vector<Group> table;
+    size_t mask = 0;
+    size_t numUsed = 0;
+
+    std::vector<uint32_t> sparseArena;
+    std::vector<std::vector<uint32_t>> freeRuns;  // offsets of released runs, by size class
+    size_t freeWords = 0;                         // arena words in released runs
+    std::vector<uint8_t> denseArena;              // 2^registerBits bytes per dense group
+    size_t denseCount = 0;
+};
+
+#endif
@@ -0,0 +1,229 @@
+#ifndef CARDINALITYESTIMATION_HYPERLOGLOG
+#define CARDINALITYESTIMATION_HYPERLOGLOG
+//
+// HyperLogLog distinct counter. Small inputs are counted exactly in a hash map until maxTrackedValues distinct
+// values have been seen, then the sketch switches to 2^bits registers. Registers can also start sparse, or be
+// packed into 6 bits each; see HLLRepresentation.
+//
+
+#include "engine/BitOps.h"
+#include "engine/DirtyBlocks.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Multiset of 64-bit values for the exact-count phase: open addressing with linear probing, at most 3/4 full. Slots
+// are tagged with the epoch they were filled in, and a slot is empty unless its tag is current and its count
+// non-zero, so clear() only bumps the epoch. Erasing shifts the rest of the probe run back, so there are no
+// tombstones.
+class ValueCounts {
+public:
+    size_t size() const { return numValues; }
+
+    // Add one occurrence of value
+    void add(uint64_t value) {
+        if ((numValues + 1) * 4 > slots.size() * 3) {
+            grow();
+        }
+        size_t i = home(value);
+        while (occupied(slots[i])) {
+            if (slots[i].value == value) {
+                slots[i].count++;
+                return;
+            }
+            i = (i + 1) & mask;
+        }
+        slots[i] = Slot{value, 1, epoch};
+        numValues++;
+    }
+
+    // Forget one occurrence of value, if it is present
+    void remove(uint64_t value);
+
+    // Call fn(value, count) for every value
+    template <typename Fn>
+    void forEach(Fn fn) const {
+        for (const Slot& slot : slots) {
+            if (occupied(slot)) {
+                fn(slot.value, slot.count);
+            }
+        }
+    }
+
+    // Empty the set in O(1), keeping its storage
+    void clear();
+    // Empty the set and free its storage
+    void release();
+
+    size_t memoryUsage() const { return slots.capacity() * sizeof(Slot); }
+
+private:
+    struct Slot {
+        uint64_t value;
+        uint32_t count;
+        uint32_t epoch;
+    };
+
+    bool occupied(const Slot& slot) const { return slot.epoch == epoch && slot.count != 0; }
+
+    size_t home(uint64_t value) const {
+        // Packed tuples are far from random; the MurmurHash3 finalizer spreads them over the table
+        value ^= value >> 33;
+        value *= UINT64_C(0xff51afd7ed558ccd);
+        value ^= value >> 33;
+        return static_cast<size_t>(value) & mask;
+    }
+
+    void grow();
+
+    std::vector<Slot> slots;
+    size_t mask = 0;
+    size_t numValues = 0;
+    uint32_t epoch = 1;  // fresh slots carry epoch 0, so they start empty
+};
+
+// How registers are stored. EXACT counts values in a hash map before switching to DENSE registers; SPARSE keeps
+// (index, rank) pairs for the registers that were hit and switches to DENSE once that is no smaller; DENSE uses one
+// byte per register; PACKED uses 6 bits per register.
+enum class HLLRepresentation { EXACT, SPARSE, DENSE, PACKED };
+
+// CLASSIC: harmonic mean with linear counting for small ranges. ERTL: the improved estimator from Ertl, "New
+// cardinality estimation algorithms for HyperLogLog sketches" (2017), which needs no empirical bias tables.
+enum class HLLEstimator { CLASSIC, ERTL };
+
+class HyperLogLog {
+private:
+    // DENSE: one byte per register; PACKED: 6 bits per register. Registers come in blocks of kBlockRegisters that are
+    // zeroed lazily: a block holds stale bytes, read as zero, until touched marks it dirty.
+    std::vector<uint8_t> registers;
+    DirtyBlocks touched;
+    static const int kBlockShift = 6;
+    static const int kBlockRegisters = 1 << kBlockShift;
+    std::vector<uint32_t> sparse;    // SPARSE: (index << 6) | rank, sorted and deduplicated up to sparseSorted
+    size_t sparseSorted = 0;
+    int numRegisters;
+    int registerBits;
+    ValueCounts valueFrequency;  // every value seen, while counting exactly
+    const size_t maxTrackedValues = 10000;
+    const HLLRepresentation initial;
+    HLLRepresentation representation;
+    HLLEstimator estimator;
+
+    // Switch from exact counting to registers, carrying over every value seen so far
+    void promote();
+    // Register update for every representation but DENSE
+    void updateRegister(int idx, uint8_t rank);
+    void compactSparse();
+    void convertSparse();
+    // Representation used once the exact phase is over
+    HLLRepresentation registerRepresentation() const {
+        return initial == HLLRepresentation::EXACT ? HLLRepresentation::DENSE : initial;
+    }
+    // Switch storage to target, cleared. Keeps the allocated capacity unless releaseStorage() ran first.
+    void enterRepresentation(HLLRepresentation target);
+    void releaseStorage();
+    // Make the block holding register idx writable, zeroing it if it is still clean
+    void touchBlock(int idx) {
+        if (!touched.dirty(static_cast<size_t>(idx) >> kBlockShift)) {
+            zeroBlock(static_cast<size_t>(idx) >> kBlockShift);
+        }
+    }
+    void zeroBlock(size_t block);
+    // Registers are only read through here (or from dirty blocks), so stale bytes never leak out
+    uint8_t denseRegister(int idx) const {
+        return touched.dirty(static_cast<size_t>(idx) >> kBlockShift) ? registers[idx] : 0;
+    }
+    uint8_t packedRegister(int idx) const {
+        if (!touched.dirty(static_cast<size_t>(idx) >> kBlockShift)) {
+            return 0;
+        }
+        const size_t bit = static_cast<size_t>(idx) * 6;
+        return static_cast<uint8_t>(((registers[bit >> 3] | (registers[(bit >> 3) + 1] << 8)) >> (bit & 7)) & 63);
+    }
+    void setPackedRegister(int idx, uint8_t rank);
+    // Number of registers holding each value 0..65
+    void registerHistogram(int counts[66]) const;
+    // Call fn(index, rank) for every non-zero register
+    template <typename Fn>
+    void forEachRegister(Fn fn) const;
+
+public:
+    HyperLogLog(int bits = 14, bool exactPhase = true)
+        : HyperLogLog(bits, exactPhase ? HLLRepresentation::EXACT : HLLRepresentation::DENSE) {}
+    HyperLogLog(int bits, HLLRepresentation start, HLLEstimator estimator = HLLEstimator::CLASSIC);
+
+    static uint64_t hashValue(uint64_t value);
+
+    bool exact() const { return representation == HLLRepresentation::EXACT; }
+    int precision() const { return registerBits; }
+    HLLRepresentation currentRepresentation() const { return representation; }
+
+    void setEstimator(HLLEstimator kind) { estimator = kind; }
+
+    void add(uint64_t value) {
+        if (exact()) {
+            valueFrequency.add(value);
+            if (valueFrequency.size() > maxTrackedValues) {
+                promote();
+            }
+            return;
+        }
+        addHash(hashValue(value));
+    }
+
+    // Forget one occurrence of a value. Only possible while counting exactly; registers cannot unlearn a value.
+    void remove(uint64_t value) {
+        if (!exact()) {
+            return;
+        }
+        valueFrequency.remove(value);
+    }
+
+    // Register update for an already hashed value; ends the exact-count phase if it is still running
+    void addHash(uint64_t hash) {
+        int idx = hash >> (64 - registerBits);
+        // Rank comes from the bits below the register index; the sentinel bit caps it at 64 - registerBits + 1
+        uint64_t rest = (hash << registerBits) | (UINT64_C(1) << (registerBits - 1));
+        uint8_t rank = static_cast<uint8_t>(1 + countLeadingZeros(rest));
+        if (representation == HLLRepresentation::DENSE) {
+            touchBlock(idx);
+            registers[idx] = std::max(registers[idx], rank);
+        } else {
+            updateRegister(idx, rank);
+        }
+    }
+
+    // Union another sketch into this one. A sketch of higher precision is folded down to this one's; a sketch of
+    // lower precision first downgrades this one to match.
+    void merge(const HyperLogLog& other);
+
+    // Re-encode the registers as sparse pairs or 6-bit packed registers, whichever is smaller, ending the
+    // exact-count phase if its hash map is larger than that. Estimates are unchanged. Returns the bytes freed.
+    size_t compact();
+
+    // Fold the registers down to 2^bits (no-op unless bits is below the current precision). The result is the
+    // sketch those values would have produced at the lower precision; the standard error grows by 2^((p - bits) / 2).
+    void downgrade(int bits);
+
+    double estimate() const;
+
+    // Relative standard error of estimate(): 0 while counting exactly, otherwise 1.04 / sqrt(2^bits)
+    double standardError() const;
+
+    // Estimate from a register histogram (counts[r] registers hold r, for r in 0..65) at precision registerBits, for
+    // register sets kept outside a HyperLogLog
+    static double estimateHistogram(const int counts[66], int registerBits, HLLEstimator estimator);
+
+    // Bytes held by the sketch, including its heap storage
+    size_t memoryUsage() const;
+
+    // Start over in the initial representation. Storage is kept, so resetting and refilling does not allocate, and
+    // registers are zeroed lazily, so a reset costs one bit-clear per 64 blocks of 64 registers.
+    void reset();
+
+    // Clear and skip the exact-count phase, e.g. before merging register-only parts back together
+    void resetRegisters();
+};
+
+#endif
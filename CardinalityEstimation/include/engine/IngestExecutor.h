@@ -0,0 +1,58 @@
+#ifndef CARDINALITYESTIMATION_INGESTEXECUTOR
+#define CARDINALITYESTIMATION_INGESTEXECUTOR
+//
+// Background executor used by CEEngine::submit. Batches are applied in submission order on a single worker thread;
+// the queue is bounded so fast producers are throttled instead of growing memory without limit.
+//
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+class IngestExecutor {
+public:
+    using Batch = std::vector<std::tuple<int, int>>;
+    using ApplyFn = std::function<void(const Batch&)>;
+
+    IngestExecutor(ApplyFn apply, size_t capacity);
+    ~IngestExecutor();
+
+    IngestExecutor(const IngestExecutor&) = delete;
+    IngestExecutor& operator=(const IngestExecutor&) = delete;
+
+    // Queue a batch, blocking while the queue is full. The future is ready once the batch has been applied.
+    std::future<void> submit(Batch&& batch);
+
+    // Queue a batch only if there is room. On failure the batch is left untouched.
+    bool trySubmit(Batch& batch, std::future<void>& done);
+
+    // Block until every queued batch has been applied
+    void drain();
+
+private:
+    struct Task {
+        Batch batch;
+        std::promise<void> done;
+    };
+
+    void run();
+
+    ApplyFn apply;
+    const size_t capacity;
+    std::deque<Task> queue;
+    size_t inFlight = 0;  // queued + currently being applied
+    bool stopping = false;
+    std::mutex mutex;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    std::condition_variable idle;
+    std::thread worker;
+};
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef CARDINALITYESTIMATION_KMVSKETCH
+#define CARDINALITYESTIMATION_KMVSKETCH
+//
+// K minimum values sketch (Bar-Yossef et al. 2002; Beyer et al., "On synopses for distinct-value estimation under
+// multiset operations", 2007). Keeps the k smallest distinct 64-bit hashes seen. While fewer than k distinct hashes
+// have been seen it holds all of them and counts exactly; after that the k-th smallest hash, theta, is the sampling
+// rate: every hash below theta is retained, so the k - 1 hashes below it are a uniform sample of the distinct values.
+// Two sketches over the same hash function compare sample against sample, which gives intersection and difference
+// estimates whose error scales with the size of the part being estimated rather than with the union, as it does
+// for inclusion-exclusion on HyperLogLog.
+//
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class KMVSketch {
+public:
+    // Relative standard error is about 1 / sqrt(k - 2) for the distinct count
+    explicit KMVSketch(size_t k = 2048);
+
+    size_t capacity() const { return k; }
+
+    // Add an already hashed value (hashes should be uniform over all 64 bits, e.g. HyperLogLog::hashValue)
+    void addHash(uint64_t hash) {
+        if (hash >= threshold) {
+            return;
+        }
+        pending.push_back(hash);
+        if (pending.size() >= k) {
+            compact();
+        }
+    }
+
+    void addHashes(const uint64_t* hashes, size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            addHash(hashes[i]);
+        }
+    }
+
+    void merge(const KMVSketch& other);
+
+    // Distinct count: exact below k distinct hashes, otherwise (k - 1) / (theta / 2^64)
+    double estimate() const;
+
+    // Sizes of the parts of two sets, estimated from their sketches
+    struct Overlap {
+        double intersection = 0;
+        double leftOnly = 0;   // |A \ B|
+        double rightOnly = 0;  // |B \ A|
+        double unionSize = 0;
+    };
+
+    // Both sketches are cut to the smaller sampling rate and their samples walked in order. Exact while neither
+    // sketch is full.
+    static Overlap overlap(const KMVSketch& left, const KMVSketch& right);
+
+    // Sampling threshold (UINT64_MAX while the sketch is not full) and the sorted hashes below it, e.g. to build a
+    // ThetaSketch
+    void thetaSample(uint64_t& theta, std::vector<uint64_t>& hashes) const;
+
+    // Keep only the smallest newK hashes (no-op unless newK is below the capacity)
+    void shrink(size_t newK);
+
+    // Sort the buffered hashes into the sample
+    void compact();
+
+    // Bytes held by the sketch, including its heap storage
+    size_t memoryUsage() const {
+        return sizeof(*this) + (values.capacity() + pending.capacity()) * sizeof(uint64_t);
+    }
+
+    // Empty the sketch, keeping its storage
+    void reset();
+
+private:
+    // Retained hashes in increasing order, with the buffered ones merged in (into scratch when any are buffered)
+    const std::vector<uint64_t>& sorted(std::vector<uint64_t>& scratch) const;
+    // Hashes below theta count toward estimates; theta is 2^64 (as UINT64_MAX) while the sketch is not full
+    static uint64_t thetaOf(const std::vector<uint64_t>& hashes, size_t k) {
+        return hashes.size() >= k ? hashes[k - 1] : UINT64_MAX;
+    }
+
+    std::vector<uint64_t> values;   // sorted, distinct, at most k
+    std::vector<uint64_t> pending;  // below threshold, unsorted, may repeat
+    uint64_t threshold = UINT64_MAX;  // hashes at or above it cannot enter: the k-th smallest once full
+    size_t k;
+};
+
+#endif
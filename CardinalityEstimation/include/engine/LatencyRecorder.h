@@ -0,0 +1,138 @@
+#ifndef CARDINALITYESTIMATION_LATENCYRECORDER
+#define CARDINALITYESTIMATION_LATENCYRECORDER
+//
+// Per-call latency histograms. Calls are timed with the CPU timestamp counter and counted in log-bucketed
+// histograms (8 sub-buckets per power of two, so bucket bounds are within 12.5%), one set per recording thread.
+// A thread only ever writes its own histograms, with relaxed stores and no read-modify-write, so recording never
+// contends; readers merge every thread's histograms. Tick counts are converted to nanoseconds on read.
+// Reading the timestamp counter dominates the cost (~7 ns on bare metal, ~20 ns under some hypervisors), so a
+// recorder can time only every 2^k-th call of each operation per thread. Calls are counted per thread, recorder and
+// operation, so other calls never shift which ones get timed, but the sample is still systematic: latency that
+// repeats with a period sharing a factor with 2^k is only seen at some of its phases.
+//
+
+#include "engine/BitOps.h"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+class LatencyRecorder {
+public:
+    static const int kBuckets = 8 + 61 * 8;
+
+    struct Summary {
+        uint64_t count = 0;
+        double p50Nanos = 0;
+        double p99Nanos = 0;
+        double p999Nanos = 0;
+        double maxNanos = 0;
+    };
+
+    // Times one of every sampleInterval calls per thread (rounded up to a power of two)
+    explicit LatencyRecorder(int numOps, uint32_t sampleInterval = 1);
+
+    static uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+    }
+
+    static int bucketOf(uint64_t ticks) {
+        if (ticks < 8) {
+            return static_cast<int>(ticks);
+        }
+        int e = 63 - countLeadingZeros(ticks);
+        return 8 + (e - 3) * 8 + static_cast<int>((ticks >> (e - 3)) & 7);
+    }
+
+    // Whether this thread's next call of op is one to time
+    bool sampleNext(int op) {
+        if (sampleMask == 0) {
+            return true;
+        }
+        return (++shard().calls[op] & sampleMask) == 0;
+    }
+
+    void record(int op, uint64_t ticks) {
+        std::atomic<uint64_t>& counter = shard().counts[static_cast<size_t>(op) * kBuckets + bucketOf(ticks)];
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    // Merge every thread's histogram of op; count is the number of timed calls
+    Summary summary(int op) const;
+
+    // Threads that have recorded, one shard each, and the bytes their shards hold
+    size_t shardCount() const;
+    size_t memoryUsage() const;
+
+    void reset();
+
+private:
+    struct Shard {
+        Shard(size_t counters, int numOps)
+            : counts(new std::atomic<uint64_t>[counters]()), calls(new uint32_t[numOps]()) {}
+        std::unique_ptr<std::atomic<uint64_t>[]> counts;
+        // Calls of each operation so far, for sampling; only the owning thread touches them
+        std::unique_ptr<uint32_t[]> calls;
+    };
+
+    // This thread's shard. The registry holds exactly one per thread; a small thread-local cache keyed by recorder id
+    // only saves taking the registry lock to find it.
+    Shard& shard() {
+        for (const CacheEntry& entry : cache) {
+            if (entry.recorder == id) {
+                return *entry.shard;
+            }
+        }
+        return registerThread();
+    }
+
+    // Cache miss: find this thread's shard in the registry, creating it on the thread's first call
+    Shard& registerThread();
+
+    struct CacheEntry {
+        uint64_t recorder = 0;
+        Shard* shard = nullptr;
+    };
+    static thread_local std::array<CacheEntry, 4> cache;
+    static thread_local unsigned nextCacheSlot;
+    uint32_t sampleMask;
+
+    const int numOps;
+    const uint64_t id;  // unique per recorder, never reused, so cached shards can't outlive their recorder's identity
+    mutable std::mutex registryMutex;
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::unordered_map<std::thread::id, Shard*> threadShards;
+};
+
+// Times the enclosing scope as one call of op, when the recorder samples it
+class LatencyScope {
+public:
+    LatencyScope(LatencyRecorder& recorder, int op)
+        : recorder(recorder), op(op), start(recorder.sampleNext(op) ? LatencyRecorder::now() : 0) {}
+    ~LatencyScope() {
+        if (start != 0) {
+            recorder.record(op, LatencyRecorder::now() - start);
+        }
+    }
+
+private:
+    LatencyRecorder& recorder;
+    const int op;
+    const uint64_t start;
+};
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef CARDINALITYESTIMATION_NUMATOPOLOGY
+#define CARDINALITYESTIMATION_NUMATOPOLOGY
+//
+// NUMA node layout read from sysfs, used to pin pool workers so that the sketch shards they allocate (first touch)
+// live on their own node. Platforms without the information are reported as one node holding every CPU.
+//
+
+#include <vector>
+
+class NumaTopology {
+public:
+    static NumaTopology detect();
+
+    int nodeCount() const { return static_cast<int>(nodes.size()); }
+
+    // CPU ids belonging to a node
+    const std::vector<int>& cpus(int node) const { return nodes[node]; }
+
+    // Restrict the calling thread to the given CPUs. Returns false where affinity is not supported.
+    static bool pinCurrentThread(const std::vector<int>& cpus);
+
+private:
+    std::vector<std::vector<int>> nodes;
+};
+
+#endif
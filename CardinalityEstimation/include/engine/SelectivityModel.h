@@ -0,0 +1,56 @@
+#ifndef CARDINALITYESTIMATION_SELECTIVITYMODEL
+#define CARDINALITYESTIMATION_SELECTIVITYMODEL
+//
+// Correction for the block summaries' query estimates, learned from query feedback (quals with their true count).
+// A query falls into one cell of a residual grid over the column pair: for each column, the operator of its most
+// selective qual and that qual's estimated selectivity on a log2 scale. A cell keeps a running mean of
+// log((true + 1) / (estimate + 1)), and estimates in it are scaled by exp of that mean, shrunk toward 0 while the
+// cell has few samples. Evaluating the model is a table lookup and one exp().
+//
+
+#include <common/Expression.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class SelectivityModel {
+public:
+    static const int kNumColumns = 2;
+    // Selectivities from 1 down to 2^-(kSelectivityBuckets - 1) and below
+    static const int kSelectivityBuckets = 16;
+
+    // Grid cell of a query. qualCounts holds the estimated rows matching each qual alone, liveRows the rows they
+    // are out of. Quals on other columns are ignored, as the estimator ignores them.
+    static int cellOf(const std::vector<CompareExpression>& quals, const double* qualCounts, double liveRows);
+
+    // Estimate corrected by the cell's learned residual
+    double correct(int cell, double estimate) const;
+
+    // Fold the feedback of one query into its cell
+    void train(int cell, double estimate, double trueCount);
+
+    // Feedback folded in so far
+    uint64_t samples() const { return numSamples; }
+
+    void reset();
+
+private:
+    // Per column: no qual, or EQUAL or GREATER in one of the selectivity buckets
+    static const int kColumnStates = 1 + 2 * kSelectivityBuckets;
+    static const int kCells = kColumnStates * kColumnStates;
+    // Samples at which a cell's residual counts for half
+    static constexpr float kPriorWeight = 4;
+    // Weight cap, so a cell keeps following the data as it changes
+    static constexpr float kMaxWeight = 256;
+
+    struct Cell {
+        float residual = 0;
+        float weight = 0;
+    };
+
+    std::array<Cell, kCells> cells{};
+    uint64_t numSamples = 0;
+};
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef CARDINALITYESTIMATION_SORTEDSETOPS
+#define CARDINALITYESTIMATION_SORTEDSETOPS
+//
+// Union, intersection and difference of sorted, duplicate-free arrays of 64-bit hashes, writing the result in
+// order. On x86-64 CPUs with AVX2, intersection and difference compare blocks of four against four (every rotation
+// of the other block at once) instead of one pair per branch; the union is a branch-light scalar merge. Pass
+// allowSimd = false to force the scalar code, e.g. to compare the two.
+//
+
+#include <cstddef>
+#include <cstdint>
+
+// out needs room for na + nb values
+size_t unionSorted(const uint64_t* a, size_t na, const uint64_t* b, size_t nb, uint64_t* out);
+
+// out needs room for min(na, nb) values
+size_t intersectSorted(const uint64_t* a, size_t na, const uint64_t* b, size_t nb, uint64_t* out,
+                       bool allowSimd = true);
+
+// Values of a not in b; out needs room for na values
+size_t differenceSorted(const uint64_t* a, size_t na, const uint64_t* b, size_t nb, uint64_t* out,
+                        bool allowSimd = true);
+
+// Whether the AVX2 kernels are available on this CPU
+bool sortedSetSimdSupported();
+
+#endif
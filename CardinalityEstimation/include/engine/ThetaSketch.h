@@ -0,0 +1,58 @@
+#ifndef CARDINALITYESTIMATION_THETASKETCH
+#define CARDINALITYESTIMATION_THETASKETCH
+//
+// Compact, read-only theta sketch (the model behind Apache DataSketches' Theta family): a sampling threshold theta
+// and the sorted distinct hashes below it. Every distinct value whose hash is below theta is in the sample, so the
+// set has about size() / (theta / 2^64) distinct values. Union, intersection and a-not-b cut both inputs at the
+// smaller theta and combine the samples (SortedSetOps), so the result is again a theta sketch with an unbiased
+// estimate and binomial error bounds; expressions such as unions of intersections over many partitions compose
+// without going back to the data. Built from a KMVSketch, e.g. CEEngine::thetaSketch().
+//
+
+#include "engine/KMVSketch.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThetaSketch {
+public:
+    // The empty set
+    ThetaSketch() = default;
+    // hashes must be sorted, distinct and below theta; UINT64_MAX stands for 2^64 (every hash kept)
+    ThetaSketch(uint64_t theta, std::vector<uint64_t> hashes);
+    explicit ThetaSketch(const KMVSketch& sketch);
+
+    uint64_t theta() const { return thetaValue; }
+    // Every value of the set is in the sample, so estimates are exact
+    bool exact() const { return thetaValue == UINT64_MAX; }
+    size_t size() const { return sample.size(); }
+    const std::vector<uint64_t>& hashes() const { return sample; }
+
+    double estimate() const;
+    // Estimate minus / plus numStdDevs binomial standard deviations (2 covers about 95%). Exact sketches return
+    // the exact count; the lower bound never drops below the number of sampled hashes.
+    double lowerBound(double numStdDevs = 2) const;
+    double upperBound(double numStdDevs = 2) const;
+
+    // A ∪ B. With maxSize > 0 the result keeps at most maxSize hashes, lowering theta to the first one dropped, so
+    // repeated unions stay bounded.
+    static ThetaSketch unite(const ThetaSketch& a, const ThetaSketch& b, size_t maxSize = 0);
+    // A ∩ B
+    static ThetaSketch intersect(const ThetaSketch& a, const ThetaSketch& b);
+    // A \ B
+    static ThetaSketch aNotB(const ThetaSketch& a, const ThetaSketch& b);
+
+    // Union and intersection of any number of sketches. Inputs are cut at the smallest theta of all of them up
+    // front, so no intermediate result carries hashes the final one would drop.
+    static ThetaSketch uniteAll(const std::vector<const ThetaSketch*>& parts, size_t maxSize = 0);
+    static ThetaSketch intersectAll(const std::vector<const ThetaSketch*>& parts);
+
+private:
+    // Number of hashes below theta
+    size_t countBelow(uint64_t theta) const;
+
+    uint64_t thetaValue = UINT64_MAX;
+    std::vector<uint64_t> sample;
+};
+
+#endif
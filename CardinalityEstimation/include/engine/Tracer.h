@@ -0,0 +1,106 @@
+#ifndef CARDINALITYESTIMATION_TRACER
+#define CARDINALITYESTIMATION_TRACER
+//
+// Scoped trace events for the engine's long-running phases (prepare, resync), kept in a process-wide in-memory ring
+// buffer and dumped as Chrome trace JSON (chrome://tracing, Perfetto). Events are coarse (one per phase per block),
+// so recording takes a mutex. The CE_TRACE_SCOPE macros compile to nothing unless the library is built with
+// -DCE_TRACING=ON; when compiled in, a scope costs one relaxed load while the tracer is stopped.
+//
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class Tracer {
+public:
+    struct Event {
+        const char* category = "";
+        const char* name = "";
+        const char* argName = nullptr;  // optional numeric argument, shown in the event's args
+        int64_t arg = 0;
+        uint32_t threadId = 0;
+        uint64_t startNanos = 0;        // since start()
+        uint64_t durationNanos = 0;
+    };
+
+    // The process-wide tracer every CE_TRACE_SCOPE records into
+    static Tracer& global();
+
+    // Clear the buffer and start recording. Once capacity events are held, the oldest are overwritten.
+    void start(size_t capacity = 1 << 16);
+    void stop();
+
+    bool enabled() const { return active.load(std::memory_order_relaxed); }
+
+    // Nanoseconds since start()
+    uint64_t now() const;
+
+    void record(const Event& event);
+
+    // Buffered events, oldest first, and the number overwritten since start()
+    std::vector<Event> events() const;
+    uint64_t overwritten() const;
+
+    // Chrome trace JSON ("X" complete events, microsecond timestamps)
+    void writeChromeJson(std::ostream& out) const;
+    bool writeChromeJson(const std::string& path) const;
+
+    // Small id of the calling thread, stable for the thread's lifetime
+    static uint32_t currentThreadId();
+
+private:
+    std::atomic<bool> active{false};
+    std::atomic<uint64_t> epochNanos{0};
+    mutable std::mutex bufferMutex;
+    std::vector<Event> ring;
+    uint64_t written = 0;  // events recorded since start(); the next goes to ring[written % ring.size()]
+};
+
+// Records the enclosing scope as one event while the global tracer is running
+class TraceScope {
+public:
+    TraceScope(const char* category, const char* name, const char* argName = nullptr, int64_t arg = 0) {
+        Tracer& tracer = Tracer::global();
+        if (tracer.enabled()) {
+            event.category = category;
+            event.name = name;
+            event.argName = argName;
+            event.arg = arg;
+            event.startNanos = tracer.now();
+            live = true;
+        }
+    }
+
+    ~TraceScope() {
+        if (live) {
+            Tracer& tracer = Tracer::global();
+            event.durationNanos = tracer.now() - event.startNanos;
+            event.threadId = Tracer::currentThreadId();
+            tracer.record(event);
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    Tracer::Event event;
+    bool live = false;
+};
+
+#define CE_TRACE_CONCAT_INNER(a, b) a##b
+#define CE_TRACE_CONCAT(a, b) CE_TRACE_CONCAT_INNER(a, b)
+#ifdef CE_TRACING
+#define CE_TRACE_SCOPE(category, name) TraceScope CE_TRACE_CONCAT(traceScope, __LINE__)(category, name)
+#define CE_TRACE_SCOPE_ARG(category, name, argName, arg) \
+    TraceScope CE_TRACE_CONCAT(traceScope, __LINE__)(category, name, argName, static_cast<int64_t>(arg))
+#else
+#define CE_TRACE_SCOPE(category, name) static_cast<void>(0)
+#define CE_TRACE_SCOPE_ARG(category, name, argName, arg) static_cast<void>(0)
+#endif
+
+#endif
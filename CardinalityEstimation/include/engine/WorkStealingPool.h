@@ -0,0 +1,79 @@
+#ifndef CARDINALITYESTIMATION_WORKSTEALINGPOOL
+#define CARDINALITYESTIMATION_WORKSTEALINGPOOL
+//
+// Fixed-size thread pool with one task deque per worker. A task is queued on its home worker (task index modulo the
+// pool size), so the same slice of work keeps landing on the same thread from batch to batch; idle workers steal
+// from the other end of their peers' deques to balance skewed batches. Workers can optionally be pinned round-robin
+// to NUMA nodes.
+//
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkStealingPool {
+public:
+    // fn(taskIndex, workerIndex)
+    using TaskFn = std::function<void(size_t, int)>;
+
+    explicit WorkStealingPool(int numThreads, bool pinToNodes = false);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    int size() const { return static_cast<int>(workers.size()); }
+
+    // NUMA node a worker is pinned to (0 when pinning is off)
+    int nodeOf(int worker) const { return workers[worker]->node; }
+
+    // Run fn for every task index in [0, numTasks) and wait for all of them to finish
+    void parallelFor(size_t numTasks, const TaskFn& fn);
+
+    // Run fn(workerIndex) exactly once on every worker thread, e.g. to first-touch per-worker memory
+    void onEachWorker(const std::function<void(int)>& fn);
+
+private:
+    struct Job {
+        const TaskFn* fn;
+        size_t remaining;  // guarded by mutex
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+
+    struct Task {
+        Job* job;
+        size_t index;
+        bool stealable;
+    };
+
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        std::atomic<size_t> queued{0};  // tasks in the deque, stealable or not
+        std::thread thread;
+        int node = 0;
+        std::vector<int> cpus;  // empty when unpinned
+    };
+
+    void schedule(Job& job, size_t numTasks, bool stealable);
+    void run(int self);
+    bool popLocal(int self, Task& task);
+    bool steal(int self, Task& task);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    // Stealable tasks in any deque. Idle workers wait for this or their own deque: a pinned task waiting on a busy
+    // peer is no reason to wake.
+    std::atomic<size_t> stealable{0};
+    bool stopping = false;
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+};
+
+#endif
@@ -7,6 +7,11 @@
 #include <common/Root.h>
 #include <common/Expression.h>
 #include <executer/DataExecuter.h>
+#include <executer/DataGenerator.h>
+#include <climits>
+#include <cstdint>
+#include <memory>
+#include <tuple>
 
 /**
  * An enum stands for the action operator.
@@ -29,14 +34,76 @@ private:
     int end;
     int count;
     Action curAction;
-    std::vector<std::vector<int>> set;
+    // Source of tuples, deleted ids and query constants
+    DataGenerator generator;
+    // Column store: each column is a list of fixed-size int32 chunks. Appends fill the last chunk and start a new one
+    // when it is full, so rows never move and growth never copies existing data.
+    static const int kChunkBits = 16;
+    static const int kChunkRows = 1 << kChunkBits;
+    static const int kNumColumns = 2;
+    std::vector<std::unique_ptr<int32_t[]>> chunks[kNumColumns];
+    int numRows = 0;
+    void append(int32_t a, int32_t b);
+    int32_t value(int columnIdx, int tupleId) const
+    {
+        return chunks[columnIdx][tupleId >> kChunkBits][tupleId & (kChunkRows - 1)];
+    }
+    // Rows [tupleId, end of its chunk) of one column are contiguous from here
+    const int32_t *columnAt(int columnIdx, int tupleId) const
+    {
+        return chunks[columnIdx][tupleId >> kChunkBits].get() + (tupleId & (kChunkRows - 1));
+    }
+    // Deletion vector: bit i is set once tuple i has been deleted
+    std::vector<uint64_t> deleted;
+    // Zone map of one block of kZoneRows consecutive tuple ids. Bounds only widen (deletes leave them as they are),
+    // so a zone map can rule a block out or in but never hides a live row.
+    struct Zone {
+        int minValue[2] = {INT_MAX, INT_MAX};
+        int maxValue[2] = {INT_MIN, INT_MIN};
+        int live = 0;
+    };
+    static const int kZoneBits = 12;
+    static const int kZoneRows = 1 << kZoneBits;
+    std::vector<Zone> zones;
+    void addToZone(int tupleId);
+    int scanZone(int first, int rows, const std::vector<CompareExpression> &quals) const;
+    // Scan threads for countMatches; null until setScanThreads asks for more than one
+    class ScanThreads;
+    std::unique_ptr<ScanThreads> pool;
     std::vector<int> generateInsert();
     int generateDelete();
+    bool isDeleted(int tupleId) const
+    {
+        return (deleted[tupleId >> 6] >> (tupleId & 63)) & 1;
+    }
+    void markDeleted(int tupleId)
+    {
+        deleted[tupleId >> 6] |= uint64_t(1) << (tupleId & 63);
+        zones[tupleId >> kZoneBits].live--;
+    }
 
 public:
-    DataExecuterDemo(int end, int count);
+    // Base data of end + 1 tuples followed by count actions, all drawn from spec with the given seed
+    DataExecuterDemo(int end, int count, const DataSpec &spec = DataSpec(), uint64_t seed = 1);
+    ~DataExecuterDemo();
     Action getNextAction();
+    // Row adapter over the column store for the DataExecuter interface
     void readTuples(int tupleId, int offset, std::vector<std::vector<int>> &vec);
+    /**
+     * Delete a batch of tuples by id, as a CDC feed would. Ids that are out of range or already deleted are skipped.
+     * @param tupleIds Ids to delete.
+     * @param removed Receives the values of the tuples actually deleted, ready for CEEngine::deleteTuples.
+     */
+    void deleteTuples(const std::vector<int> &tupleIds, std::vector<std::tuple<int, int>> &removed);
+    /**
+     * Exact number of live tuples satisfying every qual. Blocks whose zone maps exclude a qual are skipped and blocks
+     * whose zone maps satisfy every qual are counted without reading their rows.
+     */
+    int countMatches(const std::vector<CompareExpression> &quals) const;
+    /**
+     * Split countMatches scans across numThreads workers (1 = scan on the calling thread).
+     */
+    void setScanThreads(int numThreads);
     double answer(int ans);
 };
 
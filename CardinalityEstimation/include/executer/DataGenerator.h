@@ -0,0 +1,118 @@
+#ifndef CARDINALITYESTIMATION_DATAGENERATOR
+#define CARDINALITYESTIMATION_DATAGENERATOR
+//
+// Deterministic tuple generators for tests, benchmarks and the demo executer. Every generator owns its own
+// xoshiro256** state seeded through SplitMix64, so equal seeds give equal data on every platform and generators on
+// different threads never share state. Bounded values use Lemire's multiply-shift reduction instead of a division.
+//
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+class Xoshiro256 {
+public:
+    explicit Xoshiro256(uint64_t seed);
+
+    uint64_t next()
+    {
+        const uint64_t result = rotl(s[1] * 5, 7) * 9;
+        const uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+
+    // Map 32 random bits to [0, range) without bias, drawing again in the rare rejected case. range must be > 0.
+    uint32_t reduce(uint32_t x, uint32_t range)
+    {
+        uint64_t m = static_cast<uint64_t>(x) * range;
+        if (static_cast<uint32_t>(m) < range) {
+            const uint32_t threshold = (0u - range) % range;
+            while (static_cast<uint32_t>(m) < threshold) {
+                m = static_cast<uint64_t>(static_cast<uint32_t>(next() >> 32)) * range;
+            }
+        }
+        return static_cast<uint32_t>(m >> 32);
+    }
+
+    // Uniform value in [0, range)
+    uint32_t bounded(uint32_t range) { return reduce(static_cast<uint32_t>(next() >> 32), range); }
+
+private:
+    static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+    uint64_t s[4];
+};
+
+enum class Distribution { UNIFORM, ZIPF, CORRELATED, SEQUENTIAL, CONSTANT, DUPLICATES };
+
+struct DataSpec {
+    Distribution distribution = Distribution::UNIFORM;
+    // UNIFORM, ZIPF, CORRELATED and DUPLICATES draw values from [0, maxValue]
+    int maxValue = INT_MAX;
+    // ZIPF: value k is drawn with probability proportional to 1 / (k + 1)^zipfS, independently per column. At most
+    // 2^22 distinct values are used.
+    double zipfS = 1.0;
+    // CORRELATED: column 1 is column 0 plus a uniform offset in [0, correlationSpread]
+    int correlationSpread = 1000;
+    // DUPLICATES: tuples are drawn uniformly from a fixed pool of this many random tuples
+    int distinctTuples = 1000;
+    // SEQUENTIAL: tuples (start + i, start + i + 1); CONSTANT: every tuple is (start, start)
+    int start = 0;
+};
+
+class DataGenerator {
+public:
+    DataGenerator(const DataSpec& spec, uint64_t seed);
+
+    // Write the next n tuples of the stream to out
+    void fill(std::tuple<int, int>* out, size_t n);
+
+    std::vector<std::tuple<int, int>> generate(size_t n);
+
+    std::tuple<int, int> next()
+    {
+        std::tuple<int, int> tuple;
+        fill(&tuple, 1);
+        return tuple;
+    }
+
+    // Uniform value in [0, range) from the same stream, for choosing ids, operators and the like
+    uint32_t uniform(uint32_t range) { return rng.bounded(range); }
+
+    const DataSpec& spec() const { return dataSpec; }
+
+private:
+    // Vose alias table column: keep the column's own value when the coin is below threshold, else take alias.
+    // Both halves sit together so a draw costs one cache miss.
+    struct AliasEntry {
+        uint32_t threshold;
+        int alias;
+    };
+
+    // One 64-bit draw picks a column with its high half and flips that column's coin with the low half
+    int zipfValue(uint64_t x)
+    {
+        const uint32_t column = rng.reduce(static_cast<uint32_t>(x >> 32), static_cast<uint32_t>(aliasTable.size()));
+        const AliasEntry& entry = aliasTable[column];
+        return static_cast<uint32_t>(x) < entry.threshold ? static_cast<int>(column) : entry.alias;
+    }
+
+    void buildZipf();
+
+    DataSpec dataSpec;
+    Xoshiro256 rng;
+    uint32_t valueRange;  // maxValue + 1
+    int64_t sequence = 0;
+    std::vector<AliasEntry> aliasTable;
+    std::vector<std::tuple<int, int>> pool;
+};
+
+#endif
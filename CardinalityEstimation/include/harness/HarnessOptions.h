@@ -0,0 +1,45 @@
+#ifndef CARDINALITYESTIMATION_HARNESSOPTIONS
+#define CARDINALITYESTIMATION_HARNESSOPTIONS
+//
+// Command-line and environment options shared by the test suite and the benchmarks, so every run can be repeated
+// exactly: the data seed, CPU pinning of the timing thread and the number of untimed warmup runs.
+//
+//   --seed N    / CE_SEED       seed for all generated data (decimal, or hex with a 0x prefix)
+//   --pin CPU   / CE_PIN_CPU    pin the main (timing) thread to one CPU
+//   --warmup N  / CE_WARMUP     untimed runs before each timed region
+//   --trace F   / CE_TRACE      record engine phases and write them to F as Chrome trace JSON (needs CE_TRACING)
+//
+// Command-line flags override the environment. Anything else on the command line is kept as a positional argument.
+//
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct HarnessOptions {
+    uint64_t seed;
+    int pinCpu = -1;  // -1 = not pinned
+    int warmupRuns;
+    std::vector<std::string> positional;
+    std::string seedSource = "default";
+    std::string tracePath;  // empty = no trace
+
+    HarnessOptions(uint64_t defaultSeed, int defaultWarmupRuns) : seed(defaultSeed), warmupRuns(defaultWarmupRuns) {}
+
+    // Read the environment, then argv. Returns false (after printing why) on a malformed value.
+    bool parse(int argc, char** argv);
+
+    // Pin the calling thread to pinCpu if one was requested. Returns false if pinning failed.
+    bool pinCurrentThread() const;
+
+    // Start the global tracer if a trace was requested; finishTrace() stops it and writes tracePath. Both return
+    // false (after printing why) when tracing is compiled out or the file cannot be written.
+    bool startTrace() const;
+    bool finishTrace() const;
+
+    // One line describing the run, printed before any results so they can be reproduced
+    void log(std::ostream& out) const;
+};
+
+#endif
@@ -0,0 +1,252 @@
+#include "engine/BlockSummary.h"
+#include <algorithm>
+
+namespace {
+    // Bucket of a non-negative magnitude x < 2^31
+    inline int magnitudeBucket(uint32_t x) {
+        if (x < 8) {
+            return static_cast<int>(x);
+        }
+        int e = 63 - countLeadingZeros(x);
+        return 8 + (e - 3) * 8 + static_cast<int>((x >> (e - 3)) & 7);
+    }
+
+    inline int64_t magnitudeLow(int m) {
+        if (m < 8) {
+            return m;
+        }
+        int e = (m - 8) / 8 + 3;
+        return static_cast<int64_t>(8 + (m - 8) % 8) << (e - 3);
+    }
+
+    inline int64_t magnitudeHigh(int m) {
+        if (m < 8) {
+            return m;
+        }
+        int e = (m - 8) / 8 + 3;
+        return (static_cast<int64_t>(8 + (m - 8) % 8 + 1) << (e - 3)) - 1;
+    }
+
+    const int kHalf = LogHistogram::kBuckets / 2;
+}
+
+int LogHistogram::bucketOf(int value)
+{
+    if (value >= 0) {
+        return kHalf + magnitudeBucket(static_cast<uint32_t>(value));
+    }
+    return kHalf - 1 - magnitudeBucket(static_cast<uint32_t>(-(static_cast<int64_t>(value) + 1)));
+}
+
+int64_t LogHistogram::bucketLow(int bucket)
+{
+    return bucket >= kHalf ? magnitudeLow(bucket - kHalf) : -magnitudeHigh(kHalf - 1 - bucket) - 1;
+}
+
+int64_t LogHistogram::bucketHigh(int bucket)
+{
+    return bucket >= kHalf ? magnitudeHigh(bucket - kHalf) : -magnitudeLow(kHalf - 1 - bucket) - 1;
+}
+
+double LogHistogram::countAbove(int bucket) const
+{
+    double total = 0;
+    for (int b = bucket + 1; b < kBuckets; ++b) {
+        total += counts[b];
+    }
+    return total;
+}
+
+double LogHistogram::countGreater(int value, int lo, int hi) const
+{
+    const int first = bucketOf(value);
+    double total = countAbove(first);
+    if (counts[first] > 0) {
+        int64_t low = std::max<int64_t>(bucketLow(first), lo);
+        int64_t high = std::min<int64_t>(bucketHigh(first), hi);
+        if (high >= low && high > value) {
+            total += counts[first] * static_cast<double>(high - std::max<int64_t>(value, low - 1)) / (high - low + 1);
+        }
+    }
+    return total;
+}
+
+void LogHistogram::countGreaterBounds(int value, int lo, int hi, double& lower, double& upper) const
+{
+    const int first = bucketOf(value);
+    lower = upper = countAbove(first);
+    if (counts[first] > 0) {
+        int64_t low = std::max<int64_t>(bucketLow(first), lo);
+        int64_t high = std::min<int64_t>(bucketHigh(first), hi);
+        if (high >= low && high > value) {
+            upper += counts[first];
+            if (low > value) {
+                lower += counts[first];
+            }
+        }
+    }
+}
+
+double ColumnSummary::countEqual(int value, int64_t liveRows) const
+{
+    if (value < minValue || value > maxValue || liveRows <= 0) {
+        return 0;
+    }
+    const int bucket = LogHistogram::bucketOf(value);
+    const double inBucket = histogram.count(bucket);
+    if (inBucket <= 0) {
+        return 0;
+    }
+    // Spread the block's distinct values over buckets in proportion to their rows
+    const int64_t width = std::min<int64_t>(LogHistogram::bucketHigh(bucket), maxValue) -
+                          std::max<int64_t>(LogHistogram::bucketLow(bucket), minValue) + 1;
+    double distinctInBucket = distinct.estimate() * inBucket / liveRows;
+    distinctInBucket = std::min<double>(std::max(1.0, distinctInBucket), static_cast<double>(std::max<int64_t>(1, width)));
+    return inBucket / distinctInBucket;
+}
+
+double ColumnSummary::countGreater(int value) const
+{
+    if (value >= maxValue) {
+        return 0;
+    }
+    return histogram.countGreater(value, minValue, maxValue);
+}
+
+void ColumnSummary::equalBounds(int value, double& lower, double& upper) const
+{
+    lower = upper = 0;
+    if (value < minValue || value > maxValue) {
+        return;
+    }
+    // Every row equal to value is in its bucket, and all of the bucket is when the zone map leaves it one value
+    const int bucket = LogHistogram::bucketOf(value);
+    upper = std::max(0, histogram.count(bucket));
+    const int64_t width = std::min<int64_t>(LogHistogram::bucketHigh(bucket), maxValue) -
+                          std::max<int64_t>(LogHistogram::bucketLow(bucket), minValue) + 1;
+    if (width <= 1) {
+        lower = upper;
+    }
+}
+
+void ColumnSummary::greaterBounds(int value, double& lower, double& upper) const
+{
+    if (value >= maxValue) {
+        lower = upper = 0;
+        return;
+    }
+    histogram.countGreaterBounds(value, minValue, maxValue, lower, upper);
+}
+
+BlockSummary::BlockSummary(int pairPrecision) : pairs(pairPrecision, false) {}
+
+void BlockSummary::insert(const std::tuple<int, int>& tuple, uint64_t pairHash, const uint64_t* columnHashes)
+{
+    const int values[kNumColumns] = {std::get<0>(tuple), std::get<1>(tuple)};
+    pairs.addHash(pairHash);
+    for (int c = 0; c < kNumColumns; ++c) {
+        ColumnSummary& column = columns[c];
+        column.minValue = std::min(column.minValue, values[c]);
+        column.maxValue = std::max(column.maxValue, values[c]);
+        column.distinct.addHash(columnHashes[c]);
+        column.histogram.add(values[c], 1);
+    }
+    numLive++;
+    version++;
+}
+
+void BlockSummary::remove(const std::tuple<int, int>& tuple)
+{
+    const int values[kNumColumns] = {std::get<0>(tuple), std::get<1>(tuple)};
+    for (int c = 0; c < kNumColumns; ++c) {
+        columns[c].histogram.add(values[c], -1);
+    }
+    numLive--;
+    deletesSinceBuild++;
+    version++;
+}
+
+double BlockSummary::estimateMatches(const std::vector<CompareExpression>& quals, double* qualCounts) const
+{
+    if (numLive <= 0) {
+        return 0;
+    }
+    double matches = static_cast<double>(numLive);
+    for (size_t i = 0; i < quals.size(); ++i) {
+        const CompareExpression& expr = quals[i];
+        if (expr.columnIdx < 0 || expr.columnIdx >= kNumColumns) {
+            continue;
+        }
+        const ColumnSummary& column = columns[expr.columnIdx];
+        double count = expr.compareOp == EQUAL ? column.countEqual(expr.value, numLive) : column.countGreater(expr.value);
+        matches *= std::min(1.0, std::max(0.0, count / numLive));
+        if (qualCounts) {
+            qualCounts[i] += count;
+        } else if (matches <= 0) {
+            return 0;
+        }
+    }
+    return matches;
+}
+
+void BlockSummary::matchBounds(const std::vector<CompareExpression>& quals, double& lower, double& upper) const
+{
+    lower = upper = 0;
+    if (numLive <= 0) {
+        return;
+    }
+    // Frechet bounds: rows matching every qual are no more than those matching any one of them, and no fewer than
+    // what is left after removing every qual's misses separately
+    const double rows = static_cast<double>(numLive);
+    double sumLower = 0;
+    int counted = 0;
+    upper = rows;
+    for (const CompareExpression& expr : quals) {
+        if (expr.columnIdx < 0 || expr.columnIdx >= kNumColumns) {
+            continue;
+        }
+        double low;
+        double high;
+        if (expr.compareOp == EQUAL) {
+            columns[expr.columnIdx].equalBounds(expr.value, low, high);
+        } else {
+            columns[expr.columnIdx].greaterBounds(expr.value, low, high);
+        }
+        sumLower += std::min(low, rows);
+        upper = std::min(upper, high);
+        counted++;
+    }
+    lower = std::max(0.0, sumLower - (counted - 1) * rows);
+}
+
+size_t BlockSummary::memoryUsage() const
+{
+    size_t bytes = sizeof(*this) - sizeof(pairs) - sizeof(columns) + pairs.memoryUsage();
+    for (const ColumnSummary& column : columns) {
+        bytes += sizeof(column) - sizeof(column.distinct) + column.distinct.memoryUsage();
+    }
+    return bytes;
+}
+
+size_t BlockSummary::compact()
+{
+    size_t freed = pairs.compact();
+    for (ColumnSummary& column : columns) {
+        freed += column.distinct.compact();
+    }
+    return freed;
+}
+
+void BlockSummary::reset()
+{
+    pairs.reset();
+    for (ColumnSummary& column : columns) {
+        column.minValue = INT_MAX;
+        column.maxValue = INT_MIN;
+        column.distinct.reset();
+        column.histogram.reset();
+    }
+    numLive = 0;
+    deletesSinceBuild = 0;
+    version++;
+}
@@ -1,151 +1,1427 @@
 #include "CardinalityEstimation.h"
-#include "xxhash/xxhash.h"
+#include "engine/BlockSummary.h"
+#include "engine/CountMinSketch.h"
+#include "engine/GroupedDistinct.h"
+#include "engine/HyperLogLog.h"
+#include "engine/IngestExecutor.h"
+#include "engine/KMVSketch.h"
+#include "engine/LatencyRecorder.h"
+#include "engine/SelectivityModel.h"
+#include "engine/Tracer.h"
+#include "engine/WorkStealingPool.h"
+#include "executer/DataGenerator.h"
 #include <cmath>
 #include <algorithm>
 #include <vector>
-#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <thread>
 
 namespace {
-    // Count leading zeros in a 64-bit integer
-    inline int countLeadingZeros(uint64_t x) {
-        if (x == 0) return 64;
-        
-        int count = 0;
-        // Start from the most significant bit
-        uint64_t mask = UINT64_C(1) << 63;
-        
-        while ((x & mask) == 0) {
-            count++;
-            mask >>= 1;
+    // Combine tuple values into a single 64-bit key
+    inline uint64_t packTuple(const std::tuple<int, int>& tuple) {
+        return (static_cast<uint64_t>(std::get<0>(tuple)) << 32) |
+               static_cast<uint32_t>(std::get<1>(tuple));
+    }
+
+    // Key for per-column summaries
+    inline uint64_t columnKey(const std::tuple<int, int>& tuple, int columnIdx) {
+        return static_cast<uint32_t>(columnIdx == 0 ? std::get<0>(tuple) : std::get<1>(tuple));
+    }
+
+    const int kNumColumns = BlockSummary::kNumColumns;
+
+    // Register bits of the engine-wide pair sketch and of each block's pair sketch
+    const int kPrecision = 14;
+
+    // Tuples per task when a batch is split across the worker pool
+    const size_t kRangeSize = 16384;
+
+    const int64_t kBlockSize = int64_t(1) << BlockSummary::kBlockBits;
+
+    // Floors for memory-budget downgrades: pair sketch precision and Count-Min width bits
+    const int kMinPrecision = 10;
+    const int kMinCountWidthBits = 8;
+    const size_t kMinOverlapSize = 256;
+
+    // Tuples applied between memory budget reports
+    const size_t kBudgetCheckInterval = 4096;
+
+    // Hashes of one tuple, computed once and shared by every summary it updates
+    struct TupleHashes {
+        uint64_t pair;
+        uint64_t columns[kNumColumns];
+    };
+
+    inline TupleHashes hashTuple(const std::tuple<int, int>& tuple) {
+        TupleHashes hashes;
+        hashes.pair = HyperLogLog::hashValue(packTuple(tuple));
+        for (int c = 0; c < kNumColumns; ++c) {
+            hashes.columns[c] = CountMinSketch::hash(columnKey(tuple, c));
         }
-        
-        return count;
+        return hashes;
     }
+
+    const int kNumOperations = static_cast<int>(CEOperation::ESTIMATE_OVERLAP) + 1;
 }
 
-class HyperLogLog {
+// Times the rest of the enclosing public call when latency stats are compiled in
+#ifdef CE_LATENCY_STATS
+#define CE_TIME_CALL(op) LatencyScope latencyScope(pImpl->latencyRecorder, static_cast<int>(op))
+#else
+#define CE_TIME_CALL(op)
+#endif
+
+// Engine-wide summaries of the live tuples
+struct Summaries {
+    HyperLogLog hll;
+    // Per-column value frequencies; signed counters so deletes are plain decrements
+    std::vector<CountMinSketch> columnCounts;
+    // Smallest pair hashes, for intersections and differences with other engines; fed the same hash as hll
+    KMVSketch overlapSketch;
+    const bool trackOverlap;
+    // Distinct column 1 values per column 0 value, when CEConfig::groupedDistinct is set
+    std::unique_ptr<GroupedDistinct> groups;
+    int64_t liveTuples = 0;
+
+    Summaries(size_t overlapSize, bool trackGroups)
+        : hll(kPrecision), columnCounts(kNumColumns, CountMinSketch()), overlapSketch(overlapSize),
+          trackOverlap(overlapSize > 0), groups(trackGroups ? new GroupedDistinct() : nullptr) {}
+
+    void insert(const std::tuple<int, int>& tuple, const TupleHashes& hashes) {
+        if (hll.exact()) {
+            hll.add(packTuple(tuple));
+        } else {
+            hll.addHash(hashes.pair);
+        }
+        if (trackOverlap) {
+            overlapSketch.addHash(hashes.pair);
+        }
+        if (groups) {
+            groups->add(std::get<0>(tuple), hashes.columns[1]);
+        }
+        for (int c = 0; c < kNumColumns; ++c) {
+            columnCounts[c].addHashed(hashes.columns[c], 1);
+        }
+        liveTuples++;
+    }
+
+    void remove(const std::tuple<int, int>& tuple, const TupleHashes& hashes) {
+        hll.remove(packTuple(tuple));
+        for (int c = 0; c < kNumColumns; ++c) {
+            columnCounts[c].addHashed(hashes.columns[c], -1);
+        }
+        liveTuples--;
+    }
+
+    void reset() {
+        hll.reset();
+        overlapSketch.reset();
+        if (groups) {
+            groups->reset();
+        }
+        for (auto& counts : columnCounts) {
+            counts.reset();
+        }
+        liveTuples = 0;
+    }
+};
+
+struct CEQuerySummaries {
+    // Shared with the engine until it next changes them (see Impl::writableBlock)
+    std::vector<std::shared_ptr<const BlockSummary>> blocks;
+    std::vector<CountMinSketch> columnCounts;
+    int64_t unlocatedDeletes = 0;
+    int64_t liveTuples = 0;
+    uint64_t feedbackGeneration = 0;
+};
+
+class CEEngine::Impl {
 private:
-    std::vector<uint8_t> registers;
-    const int numRegisters;
-    const int registerBits;
-    std::unordered_map<uint64_t, size_t> valueFrequency;  // Track frequencies for bias correction
-    const size_t maxTrackedValues = 10000;
-    bool isExactCount = true;
+    CEConfig config;
+    Summaries live;
+    // Per-block summaries; tuple id t lives in block t >> BlockSummary::kBlockBits. Published snapshots share them,
+    // so a block is copied before it changes while a snapshot still holds it.
+    std::vector<std::shared_ptr<BlockSummary>> blocks;
+    // Emptied blocks kept by prepare() for reuse, so a recycled engine doesn't reallocate its summaries
+    std::vector<std::shared_ptr<BlockSummary>> spareBlocks;
+    // Deletes that came without a tuple id since the last full resync; their blocks are unknown
+    int64_t unlocatedDeletes = 0;
+    // Uniform random sample of every inserted tuple (reservoir sampling), at most sampleCapacity tuples
+    std::vector<std::tuple<int, int>> tuples;
+    size_t sampleCapacity;
+    uint64_t tuplesSeen = 0;
+    Xoshiro256 sampleRng{0x5eed};
+    // Register bits of the pair sketches; lowered when the memory budget runs out
+    int pairPrecision = kPrecision;
+    // Memory budget registration, when CEConfig::memoryBudget is set
+    uint64_t budgetId = 0;
+    size_t sinceBudgetCheck = 0;
+    // Hashes of the batch being applied, reused between batches
+    std::vector<uint64_t> pairHashes;
+    std::vector<std::vector<uint64_t>> columnHashes;
+    // Rows [begin, end) of the batch being applied that fall into one block
+    struct BlockSegment {
+        BlockSummary* block;
+        size_t begin;
+        size_t end;
+    };
+    std::vector<BlockSegment> segments;
+    // Serializes sketch updates from the ingest thread with direct calls
+    std::mutex stateMutex;
+    // Started on the first submit so engines that never stream don't own a thread
+    std::unique_ptr<IngestExecutor> ingest;
+    // Created on the first large batch when config.numThreads > 1
+    std::unique_ptr<WorkStealingPool> pool;
+    // One register-only sketch per pool worker. Merged into hll after each batch, or kept as long-lived shards and
+    // merged only when estimating in NUMA sharding mode.
+    std::vector<std::unique_ptr<HyperLogLog>> partials;
+    std::vector<uint8_t> partialUsed;
+    // Latest published snapshot. Readers load it with std::atomic_load and never take stateMutex; a superseded
+    // snapshot is freed when its last reader drops it.
+    std::shared_ptr<const CESnapshot> published;
+    uint64_t nextVersion = 0;
+    size_t sincePublish = 0;  // tuples applied since the last publication
+    // Base data, when attached. Tuple ids below nextTupleId exist in the executer.
+    DataExecuter* dataExecuter = nullptr;
+    int64_t nextTupleId = 0;
+    bool resyncRunning = false;
+    uint64_t resyncGeneration = 0;  // bumped by prepare() to cancel a running resync
+    // Background resync thread
+    std::thread resyncThread;
+    std::mutex resyncWaitMutex;
+    std::condition_variable resyncWake;
+    bool resyncStop = false;
+    // Query feedback waiting for the trainer thread, started on the first recordFeedback
+    struct Feedback {
+        int cell;
+        double estimate;  // uncorrected, as the model corrects it
+        int trueCount;
+    };
+    std::vector<Feedback> feedbackQueue;
+    std::mutex feedbackMutex;
+    std::condition_variable feedbackWake;  // feedback queued, or stop
+    std::condition_variable feedbackIdle;  // queue drained and the model published
+    bool trainerBusy = false;
+    bool feedbackStop = false;
+    // Bumped by prepare() so feedback about the old data is dropped. Written under both stateMutex and
+    // feedbackMutex, so either is enough to read it; snapshots carry it for query traces.
+    uint64_t feedbackGeneration = 0;
+    std::thread trainerThread;
+    // Latest model trained from feedback, or null before any. Queries load it with std::atomic_load, so training
+    // never blocks them.
+    std::shared_ptr<const SelectivityModel> correction;
 
-    uint64_t hashTuple(uint64_t value) const {
-        // Use different seeds for different hash functions to reduce collisions
-        uint64_t hash1 = XXHash64(&value, sizeof(value), 0x123456789);
-        uint64_t hash2 = XXHash64(&value, sizeof(value), 0x987654321);
-        return hash1 ^ (hash2 >> 1);  // Combine hashes to reduce collisions
+    // Block b, ready to change. Snapshot readers hold no lock, so a block a snapshot still shares is replaced by a
+    // private copy first; the copy is made once per block and publication.
+    BlockSummary& writableBlock(size_t b) {
+        if (blocks[b].use_count() > 1) {
+            blocks[b] = std::make_shared<BlockSummary>(*blocks[b]);
+        } else {
+            // Orders our writes after the reads of the thread that dropped the last snapshot reference
+            std::atomic_thread_fence(std::memory_order_acquire);
+        }
+        return *blocks[b];
     }
 
-public:
-    HyperLogLog(int bits = 14) : registers(1 << bits), numRegisters(1 << bits), registerBits(bits) {}
+    BlockSummary& blockFor(int64_t tupleId) {
+        const size_t b = static_cast<size_t>(tupleId >> BlockSummary::kBlockBits);
+        while (blocks.size() <= b) {
+            blocks.push_back(newBlockLocked());
+        }
+        return writableBlock(b);
+    }
 
-    void add(uint64_t value) {
-        if (isExactCount) {
-            valueFrequency[value]++;
-            if (valueFrequency.size() > maxTrackedValues) {
-                isExactCount = false;
-                valueFrequency.clear();  // Free memory since we're switching to HLL
+    BlockSummary* findBlock(int64_t tupleId) {
+        if (tupleId < 0) {
+            return nullptr;
+        }
+        const size_t b = static_cast<size_t>(tupleId >> BlockSummary::kBlockBits);
+        return b < blocks.size() ? &writableBlock(b) : nullptr;
+    }
+
+    std::shared_ptr<BlockSummary> newBlockLocked() {
+        while (!spareBlocks.empty()) {
+            std::shared_ptr<BlockSummary> block = std::move(spareBlocks.back());
+            spareBlocks.pop_back();
+            // Spares from before a memory-budget downgrade are dropped
+            if (block->pairSketch().precision() == pairPrecision) {
+                return block;
             }
-            if (isExactCount) return;
         }
+        return std::make_shared<BlockSummary>(pairPrecision);
+    }
 
-        uint64_t hash = hashTuple(value);
-        int idx = hash >> (64 - registerBits);
-        uint8_t rank = std::min<int>(64 - registerBits, 1 + countLeadingZeros(hash | (1ULL << (64 - registerBits))));
-        registers[idx] = std::max(registers[idx], rank);
+    static std::shared_ptr<BlockSummary> buildBlock(std::shared_ptr<BlockSummary> block,
+                                                    const std::vector<std::tuple<int, int>>& batch) {
+        CE_TRACE_SCOPE_ARG("summary", "buildBlock", "tuples", batch.size());
+        for (const auto& tuple : batch) {
+            TupleHashes hashes = hashTuple(tuple);
+            block->insert(tuple, hashes.pair, hashes.columns);
+        }
+        return block;
     }
 
-    double estimate() const {
-        // Use exact count if we're still tracking all values
-        if (isExactCount) {
-            return valueFrequency.size();
+    void sampleLocked(const std::tuple<int, int>& tuple) {
+        tuplesSeen++;
+        if (tuples.size() < sampleCapacity) {
+            tuples.push_back(tuple);
+        } else if (tuplesSeen <= UINT32_MAX) {
+            uint32_t slot = sampleRng.bounded(static_cast<uint32_t>(tuplesSeen));
+            if (slot < sampleCapacity) {
+                tuples[slot] = tuple;
+            }
+        } else {
+            uint64_t slot = sampleRng.next() % tuplesSeen;
+            if (slot < sampleCapacity) {
+                tuples[static_cast<size_t>(slot)] = tuple;
+            }
         }
+    }
 
-        // Standard HyperLogLog estimation
-        double sum = 0;
-        int zeros = 0;
-        double harmonicMean = 0;
+    void insertLocked(const std::tuple<int, int>& tuple) {
+        sampleLocked(tuple);
+        TupleHashes hashes = hashTuple(tuple);
+        live.insert(tuple, hashes);
+        blockFor(nextTupleId).insert(tuple, hashes.pair, hashes.columns);
+        nextTupleId++;
+    }
 
-        for (uint8_t r : registers) {
-            double val = std::pow(2.0, -r);
-            sum += val;
-            harmonicMean += 1.0 / val;
-            if (r == 0) zeros++;
+    void deleteLocked(const std::tuple<int, int>& tuple, int64_t tupleId) {
+        live.remove(tuple, hashTuple(tuple));
+        if (BlockSummary* block = findBlock(tupleId)) {
+            block->remove(tuple);
+        } else {
+            unlocatedDeletes++;
         }
-        
-        // Calculate bias correction factor
-        double alpha;
-        switch (registerBits) {
-            case 4:  alpha = 0.673; break;
-            case 5:  alpha = 0.697; break;
-            case 6:  alpha = 0.709; break;
-            default: alpha = 0.7213 / (1.0 + 1.079 / numRegisters);
+    }
+
+    bool useParallel(size_t batchSize) const {
+        return config.numThreads > 1 && batchSize >= 2 * kRangeSize;
+    }
+
+    // Fill pairHashes and columnHashes for the batch, one pool task per row range for large batches
+    void hashBatchLocked(const std::vector<std::tuple<int, int>>& batch) {
+        CE_TRACE_SCOPE_ARG("hash", "hashBatch", "tuples", batch.size());
+        pairHashes.resize(batch.size());
+        columnHashes.resize(kNumColumns);
+        for (auto& hashes : columnHashes) {
+            hashes.resize(batch.size());
+        }
+        auto hashRange = [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                pairHashes[i] = HyperLogLog::hashValue(packTuple(batch[i]));
+            }
+            for (int c = 0; c < kNumColumns; ++c) {
+                uint64_t* hashes = columnHashes[c].data();
+                for (size_t i = begin; i < end; ++i) {
+                    hashes[i] = CountMinSketch::hash(columnKey(batch[i], c));
+                }
+            }
+        };
+        if (useParallel(batch.size())) {
+            if (!pool) {
+                startPool();
+            }
+            const size_t numRanges = (batch.size() + kRangeSize - 1) / kRangeSize;
+            pool->parallelFor(numRanges, [&](size_t range, int) {
+                hashRange(range * kRangeSize, std::min(batch.size(), (range + 1) * kRangeSize));
+            });
+        } else {
+            hashRange(0, batch.size());
         }
-        
-        double estimate = alpha * numRegisters * numRegisters / sum;
-        
-        // Enhanced small range correction
-        if (estimate <= 5.0 * numRegisters) {
-            if (zeros > 0) {
-                estimate = numRegisters * std::log(static_cast<double>(numRegisters) / zeros);
+    }
+
+    // Apply delta to every column counter for the hashed batch. Each (column, counter row) pair is its own task so
+    // no two tasks write the same counters.
+    void applyCountsLocked(size_t n, int32_t delta) {
+        CE_TRACE_SCOPE_ARG("summary", "applyCounts", "tuples", n);
+        std::vector<CountMinSketch>& columnCounts = live.columnCounts;
+        const int depth = columnCounts[0].depth();
+        if (useParallel(n)) {
+            pool->parallelFor(kNumColumns * depth, [&](size_t task, int) {
+                int c = static_cast<int>(task) / depth;
+                columnCounts[c].addHashedRow(static_cast<int>(task) % depth, columnHashes[c].data(), n, delta);
+            });
+        } else {
+            for (int c = 0; c < kNumColumns; ++c) {
+                for (int row = 0; row < depth; ++row) {
+                    columnCounts[c].addHashedRow(row, columnHashes[c].data(), n, delta);
+                }
             }
         }
-        // Large range correction with harmonic mean
-        else if (estimate > (1LL << 32) / 30.0) {
-            double harmonicEstimate = numRegisters * numRegisters / (harmonicMean / numRegisters);
-            estimate = std::min(estimate, harmonicEstimate);
+        for (int c = 0; c < kNumColumns; ++c) {
+            columnCounts[c].addToTotal(static_cast<int64_t>(n) * delta);
         }
-        
-        return std::max(1.0, estimate);  // Never return less than 1
+        live.liveTuples += static_cast<int64_t>(n) * delta;
     }
 
-    void reset() {
-        std::fill(registers.begin(), registers.end(), 0);
-        valueFrequency.clear();
-        isExactCount = true;
+    double estimateLocked(double* standardError = nullptr) const {
+        if (!config.numaSharding || !pool) {
+            if (standardError) {
+                *standardError = live.hll.standardError();
+            }
+            return live.hll.estimate();
+        }
+        HyperLogLog merged = live.hll;
+        mergePartials(merged);
+        if (standardError) {
+            *standardError = merged.standardError();
+        }
+        return merged.estimate();
     }
-};
 
-class CEEngine::Impl {
-private:
-    HyperLogLog hll;
-    std::vector<std::tuple<int, int>> tuples;
+    void publishLocked() {
+        CE_TRACE_SCOPE("merge", "publish");
+        std::shared_ptr<CEQuerySummaries> summaries = std::make_shared<CEQuerySummaries>();
+        summaries->blocks.assign(blocks.begin(), blocks.end());
+        summaries->columnCounts.reserve(live.columnCounts.size());
+        for (const CountMinSketch& counts : live.columnCounts) {
+            summaries->columnCounts.push_back(counts);
+        }
+        summaries->unlocatedDeletes = unlocatedDeletes;
+        summaries->liveTuples = live.liveTuples;
+        summaries->feedbackGeneration = feedbackGeneration;
+        // One allocation for the snapshot and its control block
+        std::shared_ptr<const CESnapshot> next = std::make_shared<const CESnapshot>(
+            ++nextVersion, estimateLocked(), static_cast<size_t>(std::max<int64_t>(0, live.liveTuples)),
+            std::move(summaries));
+        std::atomic_store(&published, next);
+        sincePublish = 0;
+    }
+
+    void noteApplied(size_t applied) {
+        sincePublish += applied;
+        if (config.snapshotInterval > 0 && sincePublish >= config.snapshotInterval) {
+            publishLocked();
+        }
+        sinceBudgetCheck += applied;
+        if (budgetId != 0 && sinceBudgetCheck >= kBudgetCheckInterval) {
+            checkBudgetLocked();
+        }
+    }
+
+    CEMemoryUsage memoryUsageLocked() const {
+        CEMemoryUsage usage;
+        usage.sample = tuples.capacity() * sizeof(tuples[0]);
+        usage.distinctSketch = live.hll.memoryUsage() + live.overlapSketch.memoryUsage();
+        for (const auto& partial : partials) {
+            usage.distinctSketch += partial->memoryUsage();
+        }
+        for (const auto& counts : live.columnCounts) {
+            usage.columnCounts += counts.memoryUsage();
+        }
+        if (live.groups) {
+            usage.groupSketches = live.groups->memoryUsage();
+        }
+        usage.blockSummaries = (blocks.capacity() + spareBlocks.capacity()) * sizeof(blocks[0]);
+        for (const auto& block : blocks) {
+            usage.blockSummaries += block->memoryUsage();
+        }
+        for (const auto& block : spareBlocks) {
+            usage.blockSummaries += block->memoryUsage();
+        }
+        usage.buffers = pairHashes.capacity() * sizeof(uint64_t);
+        for (const auto& hashes : columnHashes) {
+            usage.buffers += hashes.capacity() * sizeof(uint64_t);
+        }
+        return usage;
+    }
+
+    void checkBudgetLocked() {
+        sinceBudgetCheck = 0;
+        size_t excess = config.memoryBudget->report(budgetId, memoryUsageLocked());
+        if (excess > 0) {
+            reclaimLocked(excess);
+            config.memoryBudget->report(budgetId, memoryUsageLocked());
+        }
+    }
+
+    // Free about wanted bytes, cheapest loss first: scratch buffers, lossless re-encoding of every sketch, then
+    // alternately halving the sample and lowering sketch precision until enough is freed or both hit their floors.
+    void reclaimLocked(size_t wanted) {
+        CE_TRACE_SCOPE_ARG("summary", "reclaimMemory", "bytes", wanted);
+        const size_t before = memoryUsageLocked().total();
+        auto freed = [&] { return before - std::min(before, memoryUsageLocked().total()); };
+
+        std::vector<uint64_t>().swap(pairHashes);
+        std::vector<std::vector<uint64_t>>().swap(columnHashes);
+        std::vector<std::shared_ptr<BlockSummary>>().swap(spareBlocks);
+        live.hll.compact();
+        for (size_t b = 0; b < blocks.size(); ++b) {
+            writableBlock(b).compact();
+        }
+
+        bool shrunk = true;
+        while (freed() < wanted && shrunk) {
+            shrunk = false;
+            if (sampleCapacity > 0) {
+                sampleCapacity /= 2;
+                shrinkSampleLocked();
+                shrunk = true;
+                if (freed() >= wanted) {
+                    break;
+                }
+            }
+            if (pairPrecision > kMinPrecision) {
+                pairPrecision--;
+                live.hll.downgrade(pairPrecision);
+                live.hll.compact();
+                for (const auto& partial : partials) {
+                    partial->downgrade(pairPrecision);
+                }
+                for (size_t b = 0; b < blocks.size(); ++b) {
+                    BlockSummary& block = writableBlock(b);
+                    block.downgradePairs(pairPrecision);
+                    block.compact();
+                }
+                shrunk = true;
+            }
+            if (live.overlapSketch.capacity() > kMinOverlapSize) {
+                live.overlapSketch.shrink(live.overlapSketch.capacity() / 2);
+                shrunk = true;
+            }
+            for (auto& counts : live.columnCounts) {
+                if (counts.widthLog2() > kMinCountWidthBits) {
+                    counts.shrinkWidth(counts.widthLog2() - 1);
+                    shrunk = true;
+                }
+            }
+        }
+        // Blocks the snapshot shared were copied to be shrunk; republish so the originals are freed
+        publishLocked();
+    }
+
+    // Drop tuples past sampleCapacity. The sample is a uniform random subset, so keeping any sampleCapacity of them
+    // (a random subset of a random subset) leaves it uniform; later replacements draw against the new capacity.
+    void shrinkSampleLocked() {
+        if (tuples.size() > sampleCapacity) {
+            for (size_t i = 0; i < sampleCapacity; ++i) {
+                uint32_t j = static_cast<uint32_t>(i) + sampleRng.bounded(static_cast<uint32_t>(tuples.size() - i));
+                std::swap(tuples[i], tuples[j]);
+            }
+            tuples.resize(sampleCapacity);
+        }
+        tuples.shrink_to_fit();
+    }
+
+    void startPool() {
+        pool.reset(new WorkStealingPool(config.numThreads, config.numaSharding));
+        partials.resize(pool->size());
+        partialUsed.assign(pool->size(), 0);
+        if (config.numaSharding) {
+            // First touch on the pinned worker places each shard on that worker's node
+            pool->onEachWorker([this](int worker) { partials[worker].reset(new HyperLogLog(pairPrecision, false)); });
+        } else {
+            for (auto& partial : partials) {
+                partial.reset(new HyperLogLog(pairPrecision, false));
+            }
+        }
+    }
+
+    void resetPartials() {
+        for (size_t w = 0; w < partials.size(); ++w) {
+            if (partialUsed[w]) {
+                partials[w]->reset();
+                partialUsed[w] = 0;
+            }
+        }
+    }
+
+    // Apply a batch to the engine-wide summaries
+    void insertGlobalLocked(const std::vector<std::tuple<int, int>>& batch) {
+        for (const auto& tuple : batch) {
+            sampleLocked(tuple);
+        }
+        hashBatchLocked(batch);
+        applyCountsLocked(batch.size(), 1);
+        if (live.trackOverlap) {
+            live.overlapSketch.addHashes(pairHashes.data(), batch.size());
+        }
+        if (live.groups) {
+            // Column 1's Count-Min hashes double as the group sketches' value hashes
+            live.groups->addBatch(batch, columnHashes[1].data());
+        }
+
+        CE_TRACE_SCOPE_ARG("summary", "distinctSketch", "tuples", batch.size());
+        HyperLogLog& hll = live.hll;
+        // The exact-count phase keeps a single hash map, so it stays serial until the sketch switches to registers
+        if (hll.exact()) {
+            for (const auto& tuple : batch) {
+                hll.add(packTuple(tuple));
+            }
+            return;
+        }
+        if (!useParallel(batch.size())) {
+            for (uint64_t hash : pairHashes) {
+                hll.addHash(hash);
+            }
+            return;
+        }
+
+        // One task per row range for the pair sketch; column counters were split by counter row above
+        const size_t numRanges = (batch.size() + kRangeSize - 1) / kRangeSize;
+        pool->parallelFor(numRanges, [&](size_t range, int worker) {
+            HyperLogLog& partial = *partials[worker];
+            const size_t begin = range * kRangeSize;
+            const size_t end = std::min(batch.size(), begin + kRangeSize);
+            for (size_t i = begin; i < end; ++i) {
+                partial.addHash(pairHashes[i]);
+            }
+            partialUsed[worker] = 1;
+        });
+        if (!config.numaSharding) {
+            mergePartials(hll);
+            resetPartials();
+        }
+    }
+
+    // Apply an appended batch (ids nextTupleId onwards) to the global and block summaries
+    void insertBatchLocked(const std::vector<std::tuple<int, int>>& batch) {
+        insertGlobalLocked(batch);
+
+        // Blocks are disjoint, so each block the batch touches is its own task
+        segments.clear();
+        for (size_t begin = 0; begin < batch.size();) {
+            const int64_t id = nextTupleId + static_cast<int64_t>(begin);
+            const size_t end = std::min(batch.size(), begin + static_cast<size_t>(kBlockSize - (id & (kBlockSize - 1))));
+            segments.push_back(BlockSegment{&blockFor(id), begin, end});
+            begin = end;
+        }
+        auto applySegment = [&](size_t s, int) {
+            const BlockSegment& segment = segments[s];
+            uint64_t hashes[kNumColumns];
+            for (size_t i = segment.begin; i < segment.end; ++i) {
+                for (int c = 0; c < kNumColumns; ++c) {
+                    hashes[c] = columnHashes[c][i];
+                }
+                segment.block->insert(batch[i], pairHashes[i], hashes);
+            }
+        };
+        if (useParallel(batch.size()) && segments.size() > 1) {
+            pool->parallelFor(segments.size(), applySegment);
+        } else {
+            for (size_t s = 0; s < segments.size(); ++s) {
+                applySegment(s, 0);
+            }
+        }
+        nextTupleId += static_cast<int64_t>(batch.size());
+    }
+
+    void deleteBatchLocked(const std::vector<std::tuple<int, int>>& batch, const std::vector<int>* tupleIds) {
+        hashBatchLocked(batch);
+        applyCountsLocked(batch.size(), -1);
+        if (live.hll.exact()) {
+            for (const auto& tuple : batch) {
+                live.hll.remove(packTuple(tuple));
+            }
+        }
+        for (size_t i = 0; i < batch.size(); ++i) {
+            BlockSummary* block = tupleIds && i < tupleIds->size() ? findBlock((*tupleIds)[i]) : nullptr;
+            if (block) {
+                block->remove(batch[i]);
+            } else {
+                unlocatedDeletes++;
+            }
+        }
+    }
+
+    void mergePartials(HyperLogLog& target) const {
+        for (size_t w = 0; w < partials.size(); ++w) {
+            if (partialUsed[w]) {
+                target.merge(*partials[w]);
+            }
+        }
+    }
+
+    void applyBatch(const IngestExecutor::Batch& batch) {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        insertBatchLocked(batch);
+        noteApplied(batch.size());
+    }
+
+    IngestExecutor& executor() {
+        if (!ingest) {
+            ingest.reset(new IngestExecutor(
+                [this](const IngestExecutor::Batch& batch) { applyBatch(batch); },
+                config.ingestQueueCapacity));
+        }
+        return *ingest;
+    }
+
+    static void toBatch(const std::vector<std::vector<int>>& rows, std::vector<std::tuple<int, int>>& batch) {
+        CE_TRACE_SCOPE_ARG("io", "decodeRows", "tuples", rows.size());
+        batch.clear();
+        for (const auto& row : rows) {
+            batch.emplace_back(row[0], row[1]);
+        }
+    }
+
+    // Load tuples [0, nextTupleId) from the executer, one block at a time so rows keep their block even when the
+    // executer skips deleted ids
+    void loadLocked() {
+        std::vector<std::vector<int>> rows;
+        std::vector<std::tuple<int, int>> batch;
+        for (int64_t first = 0; first < nextTupleId; first += kBlockSize) {
+            CE_TRACE_SCOPE_ARG("phase", "loadBlock", "block", first / kBlockSize);
+            int n = static_cast<int>(std::min(kBlockSize, nextTupleId - first));
+            rows.clear();
+            {
+                CE_TRACE_SCOPE_ARG("io", "readTuples", "tuples", n);
+                dataExecuter->readTuples(static_cast<int>(first), n, rows);
+            }
+            toBatch(rows, batch);
+            insertGlobalLocked(batch);
+            blocks.push_back(buildBlock(newBlockLocked(), batch));
+        }
+    }
+
+    // Sleep long enough after a block to stay within the CPU and I/O budgets. Returns false if asked to stop.
+    bool throttle(size_t tuplesRead, std::chrono::steady_clock::time_point busyStart) {
+        CE_TRACE_SCOPE("phase", "throttle");
+        double busy = std::chrono::duration<double>(std::chrono::steady_clock::now() - busyStart).count();
+        double pause = 0;
+        if (config.resyncCpuFraction > 0 && config.resyncCpuFraction < 1) {
+            pause = busy * (1 - config.resyncCpuFraction) / config.resyncCpuFraction;
+        }
+        if (config.resyncTuplesPerSecond > 0) {
+            pause = std::max(pause, tuplesRead / config.resyncTuplesPerSecond - busy);
+        }
+        std::unique_lock<std::mutex> lock(resyncWaitMutex);
+        if (pause > 0) {
+            resyncWake.wait_for(lock, std::chrono::duration<double>(pause), [this] { return resyncStop; });
+        }
+        return !resyncStop;
+    }
+
+    // Rebuild the engine-wide pair sketch as the union of the block sketches
+    void remergeBlocksLocked() {
+        if (live.hll.exact()) {
+            return;  // exact counting already honours every delete
+        }
+        CE_TRACE_SCOPE_ARG("merge", "remergeBlocks", "blocks", blocks.size());
+        live.hll.resetRegisters();
+        for (const auto& block : blocks) {
+            live.hll.merge(block->pairSketch());
+        }
+        // Shards hold registers for deleted tuples too; everything they saw is in the blocks
+        for (size_t w = 0; w < partials.size(); ++w) {
+            partials[w]->reset();
+            partialUsed[w] = 0;
+        }
+    }
 
 public:
-    Impl() : hll(14) {}
+#ifdef CE_LATENCY_STATS
+    LatencyRecorder latencyRecorder{kNumOperations, config.latencySampleInterval};
+#endif
+
+    Impl(const CEConfig& config, DataExecuter* executer, int num)
+        : config(config), live(config.overlapSketchSize, config.groupedDistinct), sampleCapacity(config.sampleCapacity), dataExecuter(executer), nextTupleId(num) {
+        if (config.memoryBudget) {
+            budgetId = config.memoryBudget->attach([this](size_t wanted, CEMemoryUsage& usage) {
+                std::unique_lock<std::mutex> lock(stateMutex, std::try_to_lock);
+                if (!lock.owns_lock()) {
+                    return false;
+                }
+                reclaimLocked(wanted);
+                usage = memoryUsageLocked();
+                return true;
+            });
+        }
+        publishLocked();
+    }
+
+    ~Impl() {
+        if (budgetId != 0) {
+            config.memoryBudget->detach(budgetId);
+        }
+        stopResync();
+        stopTrainer();
+        // Join the ingest thread before the sketches and pool it uses are destroyed
+        ingest.reset();
+        pool.reset();
+    }
 
     void insertTuple(const std::tuple<int, int>& tuple) {
-        tuples.push_back(tuple);
-        // Combine tuple values into a single 64-bit hash
-        uint64_t combined = (static_cast<uint64_t>(std::get<0>(tuple)) << 32) | 
-                           static_cast<uint64_t>(std::get<1>(tuple));
-        hll.add(combined);
+        std::lock_guard<std::mutex> lock(stateMutex);
+        insertLocked(tuple);
+        noteApplied(1);
+    }
+
+    void insertTuples(const std::vector<std::tuple<int, int>>& batch) {
+        applyBatch(batch);
+    }
+
+    void deleteTuple(const std::tuple<int, int>& tuple, int64_t tupleId) {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        deleteLocked(tuple, tupleId);
+        noteApplied(1);
+    }
+
+    void deleteTuples(const std::vector<std::tuple<int, int>>& batch, const std::vector<int>* tupleIds) {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        deleteBatchLocked(batch, tupleIds);
+        noteApplied(batch.size());
+    }
+
+    struct BlockEstimate {
+        double matches = 0;
+        double lower = 0;
+        double upper = 0;
+    };
+
+    // Independence estimate of quals summed over the blocks, with each qual's own estimated matches added to
+    // qualCounts when given, and the range the true count lies in when withBounds is set (one more histogram
+    // lookup per qual and block)
+    static BlockEstimate blockEstimate(const CEQuerySummaries& summaries, const std::vector<CompareExpression>& quals,
+                                       bool withBounds, double* qualCounts) {
+        BlockEstimate result;
+        for (const auto& block : summaries.blocks) {
+            result.matches += block->estimateMatches(quals, qualCounts);
+            if (withBounds) {
+                double lower;
+                double upper;
+                block->matchBounds(quals, lower, upper);
+                result.lower += lower;
+                result.upper += upper;
+            }
+        }
+        return result;
+    }
+
+    // Estimated matches of quals in a snapshot, corrected by the feedback model once one is published; with bounds,
+    // also the range they lie in, and with trace, what feedback on the answer needs to train the model
+    double querySummaries(const CEQuerySummaries& summaries, const std::vector<CompareExpression>& quals,
+                          CEBounds* bounds, CEQueryTrace* trace) const {
+        std::shared_ptr<const SelectivityModel> model = std::atomic_load(&correction);
+        // Per-qual estimates of the query, which place it in a model cell
+        thread_local std::vector<double> qualCounts;
+        const bool needCell = model || trace;
+        if (needCell) {
+            qualCounts.assign(quals.size(), 0);
+        }
+        const BlockEstimate blocks =
+            blockEstimate(summaries, quals, bounds || model, needCell ? qualCounts.data() : nullptr);
+        const int cell =
+            needCell ? SelectivityModel::cellOf(quals, qualCounts.data(), static_cast<double>(summaries.liveTuples))
+                     : -1;
+        if (trace) {
+            trace->uncorrected = blocks.matches;
+            trace->cell = cell;
+            trace->generation = summaries.feedbackGeneration;
+        }
+        double total = blocks.matches;
+        // Blocks have not seen deletes without a tuple id, so up to that many of their rows may be gone
+        double lower = std::max(0.0, blocks.lower - static_cast<double>(summaries.unlocatedDeletes));
+        double upper = blocks.upper;
+        double floor = 0;
+        double confidence = 1;
+        // Count-Min never underestimates, so an equality's frequency caps the answer
+        for (const CompareExpression& expr : quals) {
+            if (expr.compareOp == EQUAL && expr.columnIdx >= 0 && expr.columnIdx < kNumColumns) {
+                const CountMinSketch& counts = summaries.columnCounts[expr.columnIdx];
+                const double cap = static_cast<double>(
+                    std::max<int64_t>(0, counts.estimate(static_cast<uint32_t>(expr.value))));
+                total = std::min(total, cap);
+                upper = std::min(upper, cap);
+                if (quals.size() == 1 && cap - counts.maxOvercount() > lower) {
+                    floor = cap - counts.maxOvercount();
+                    confidence = 1 - std::exp(-static_cast<double>(counts.depth()));
+                }
+            }
+        }
+        if (model) {
+            // The learned correction may move the estimate anywhere the summaries cannot rule out
+            total = std::min(upper, std::max(lower, model->correct(cell, blocks.matches)));
+        }
+        if (bounds) {
+            // Block bounds always contain the estimate; the Count-Min floor is only trusted up to it
+            bounds->estimate = total;
+            bounds->lower = std::min(std::max(lower, floor), total);
+            bounds->upper = std::max(upper, total);
+            bounds->confidence = floor > lower ? confidence : 1;
+        }
+        return total;
+    }
+
+    // Fold queued feedback into a private model and publish a copy after every drained batch
+    void trainLoop() {
+        SelectivityModel training;
+        uint64_t trainedGeneration = 0;
+        std::vector<Feedback> batch;
+        for (;;) {
+            uint64_t generation;
+            {
+                std::unique_lock<std::mutex> lock(feedbackMutex);
+                trainerBusy = false;
+                feedbackIdle.notify_all();
+                feedbackWake.wait(lock, [this] { return feedbackStop || !feedbackQueue.empty(); });
+                if (feedbackStop) {
+                    return;
+                }
+                batch.swap(feedbackQueue);
+                trainerBusy = true;
+                generation = feedbackGeneration;
+            }
+            if (generation != trainedGeneration) {
+                training.reset();
+                trainedGeneration = generation;
+            }
+            for (const Feedback& feedback : batch) {
+                training.train(feedback.cell, feedback.estimate, feedback.trueCount);
+            }
+            batch.clear();
+            std::shared_ptr<const SelectivityModel> next = std::make_shared<const SelectivityModel>(training);
+            std::lock_guard<std::mutex> lock(feedbackMutex);
+            // prepare() since the batch was taken: it describes data that is gone
+            if (generation == feedbackGeneration) {
+                std::atomic_store(&correction, next);
+            }
+        }
+    }
+
+    void stopTrainer() {
+        if (!trainerThread.joinable()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(feedbackMutex);
+            feedbackStop = true;
+        }
+        feedbackWake.notify_all();
+        trainerThread.join();
+    }
+
+    int query(const std::vector<CompareExpression>& quals, CEQueryTrace* trace) {
+        const std::shared_ptr<const CESnapshot> current = std::atomic_load(&published);
+        return static_cast<int>(std::llround(querySummaries(*current->summaries(), quals, nullptr, trace)));
+    }
+
+    CEBounds queryWithBounds(const std::vector<CompareExpression>& quals, CEQueryTrace* trace) {
+        const std::shared_ptr<const CESnapshot> current = std::atomic_load(&published);
+        CEBounds result;
+        querySummaries(*current->summaries(), quals, &result, trace);
+        return result;
+    }
+
+    bool recordFeedback(const CEQueryTrace& trace, int trueCount) {
+        std::lock_guard<std::mutex> lock(feedbackMutex);
+        if (trace.cell < 0 || trace.generation != feedbackGeneration ||
+            feedbackQueue.size() >= config.feedbackQueueCapacity) {
+            return false;
+        }
+        feedbackQueue.push_back(Feedback{trace.cell, trace.uncorrected, trueCount});
+        if (!trainerThread.joinable()) {
+            trainerThread = std::thread([this]() { trainLoop(); });
+        }
+        feedbackWake.notify_one();
+        return true;
+    }
+
+    void flushFeedback() {
+        std::unique_lock<std::mutex> lock(feedbackMutex);
+        feedbackIdle.wait(lock, [this] { return feedbackQueue.empty() && !trainerBusy; });
+    }
+
+    uint64_t feedbackSamples() const {
+        std::shared_ptr<const SelectivityModel> model = std::atomic_load(&correction);
+        return model ? model->samples() : 0;
+    }
+
+    bool resync() {
+        if (!dataExecuter) {
+            return false;
+        }
+        CE_TRACE_SCOPE("phase", "resync");
+        uint64_t generation;
+        int64_t unlocated;
+        std::vector<size_t> targets;
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            if (resyncRunning) {
+                return false;
+            }
+            resyncRunning = true;
+            generation = resyncGeneration;
+            // Deletes without ids could be anywhere, so they make every block a target
+            unlocated = unlocatedDeletes;
+            for (size_t b = 0; b < blocks.size(); ++b) {
+                if (unlocated > 0 || blocks[b]->deletesSinceBuild > 0) {
+                    targets.push_back(b);
+                }
+            }
+        }
+
+        bool completed = true;
+        bool rebuilt = false;
+        std::vector<std::vector<int>> rows;
+        std::vector<std::tuple<int, int>> batch;
+        for (size_t b : targets) {
+            CE_TRACE_SCOPE_ARG("phase", "resyncBlock", "block", b);
+            auto busyStart = std::chrono::steady_clock::now();
+            const int64_t first = static_cast<int64_t>(b) * kBlockSize;
+            int64_t last;
+            uint64_t version;
+            int precision;
+            {
+                std::lock_guard<std::mutex> lock(stateMutex);
+                if (resyncGeneration != generation) {
+                    completed = false;
+                    break;
+                }
+                version = blocks[b]->version;
+                precision = pairPrecision;
+                last = std::min(nextTupleId, first + kBlockSize);
+            }
+            // Reading and rebuilding happen outside the engine lock so ingest and queries keep going
+            rows.clear();
+            {
+                CE_TRACE_SCOPE_ARG("io", "readTuples", "tuples", last - first);
+                dataExecuter->readTuples(static_cast<int>(first), static_cast<int>(last - first), rows);
+            }
+            toBatch(rows, batch);
+            std::shared_ptr<BlockSummary> fresh = buildBlock(std::make_shared<BlockSummary>(precision), batch);
+            {
+                std::lock_guard<std::mutex> lock(stateMutex);
+                if (resyncGeneration != generation) {
+                    completed = false;
+                    break;
+                }
+                // A block that changed while it was being read keeps its drift until the next resync
+                if (blocks[b]->version == version) {
+                    blocks[b].swap(fresh);
+                    rebuilt = true;
+                } else {
+                    completed = false;
+                }
+            }
+            if (!throttle(rows.size(), busyStart)) {
+                completed = false;
+                break;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(stateMutex);
+        resyncRunning = false;
+        if (resyncGeneration != generation) {
+            return false;
+        }
+        if (completed) {
+            unlocatedDeletes -= unlocated;
+        }
+        if (rebuilt) {
+            remergeBlocksLocked();
+            if (budgetId != 0) {
+                checkBudgetLocked();
+            }
+            publishLocked();
+        }
+        return completed;
+    }
+
+    void startResync() {
+        if (!dataExecuter || resyncThread.joinable()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(resyncWaitMutex);
+            resyncStop = false;
+        }
+        resyncThread = std::thread([this]() {
+            for (;;) {
+                {
+                    std::unique_lock<std::mutex> lock(resyncWaitMutex);
+                    if (resyncWake.wait_for(lock, std::chrono::milliseconds(config.resyncIntervalMs),
+                                            [this] { return resyncStop; })) {
+                        return;
+                    }
+                }
+                resync();
+            }
+        });
+    }
+
+    void stopResync() {
+        if (!resyncThread.joinable()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(resyncWaitMutex);
+            resyncStop = true;
+        }
+        resyncWake.notify_all();
+        resyncThread.join();
+    }
+
+    std::future<void> submit(IngestExecutor::Batch&& batch) {
+        return executor().submit(std::move(batch));
+    }
+
+    bool trySubmit(IngestExecutor::Batch& batch, std::future<void>& done) {
+        return executor().trySubmit(batch, done);
+    }
+
+    void flush() {
+        if (ingest) {
+            ingest->drain();
+        }
     }
 
     double estimate() {
-        return hll.estimate();
+        std::lock_guard<std::mutex> lock(stateMutex);
+        return estimateLocked();
+    }
+
+    CEBounds estimateWithBounds(double numStdDevs) {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        CEBounds result;
+        double standardError;
+        result.estimate = estimateLocked(&standardError);
+        const double spread = numStdDevs * standardError * result.estimate;
+        result.lower = std::max(0.0, result.estimate - spread);
+        result.upper = result.estimate + spread;
+        if (standardError > 0) {
+            result.confidence = std::erf(numStdDevs / std::sqrt(2.0));
+        }
+        return result;
+    }
+
+    double estimateFrequency(int columnIdx, int value) {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        if (columnIdx < 0 || columnIdx >= kNumColumns) {
+            return 0;
+        }
+        return static_cast<double>(std::max<int64_t>(0, live.columnCounts[columnIdx].estimate(static_cast<uint32_t>(value))));
+    }
+
+    CEBounds estimateFrequencyWithBounds(int columnIdx, int value) {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        CEBounds result;
+        if (columnIdx < 0 || columnIdx >= kNumColumns) {
+            return result;
+        }
+        const CountMinSketch& counts = live.columnCounts[columnIdx];
+        result.estimate = static_cast<double>(std::max<int64_t>(0, counts.estimate(static_cast<uint32_t>(value))));
+        result.upper = result.estimate;
+        result.lower = std::max(0.0, result.estimate - counts.maxOvercount());
+        result.confidence = 1 - std::exp(-static_cast<double>(counts.depth()));
+        return result;
+    }
+
+    CEJoinEstimate estimateJoin(int columnIdx, Impl& other, int otherColumnIdx) {
+        CEJoinEstimate result;
+        if (columnIdx < 0 || columnIdx >= kNumColumns || otherColumnIdx < 0 || otherColumnIdx >= kNumColumns) {
+            return result;
+        }
+        // Lock both engines together, so joins in opposite directions cannot deadlock
+        std::unique_lock<std::mutex> lock(stateMutex, std::defer_lock);
+        std::unique_lock<std::mutex> otherLock(other.stateMutex, std::defer_lock);
+        if (&other == this) {
+            lock.lock();
+        } else {
+            std::lock(lock, otherLock);
+        }
+        const CountMinSketch& left = live.columnCounts[columnIdx];
+        const CountMinSketch& right = other.live.columnCounts[otherColumnIdx];
+        std::vector<double> products = left.rowInnerProducts(right);
+        if (products.empty()) {
+            return result;
+        }
+        const double width = static_cast<double>(std::min(left.width(), right.width()));
+        const double collisions = static_cast<double>(left.total()) * static_cast<double>(right.total());
+        result.upperBound = std::max(0.0, *std::min_element(products.begin(), products.end()));
+        result.maxOvercount = std::exp(1.0) / width * collisions;
+        // Every pair of distinct keys shares a column with probability 1/w, so a row overcounts by
+        // (N * M - join) / w on average; remove that and take the median, which shrugs off one unlucky row
+        for (double& product : products) {
+            product = (product - collisions / width) / (1 - 1 / width);
+        }
+        std::sort(products.begin(), products.end());
+        const size_t mid = products.size() / 2;
+        const double median = products.size() % 2 ? products[mid] : (products[mid - 1] + products[mid]) / 2;
+        result.estimate = std::min(result.upperBound, std::max(0.0, median));
+        return result;
+    }
+
+    CEOverlap estimateOverlap(Impl& other) {
+        CEOverlap result;
+        std::unique_lock<std::mutex> lock(stateMutex, std::defer_lock);
+        std::unique_lock<std::mutex> otherLock(other.stateMutex, std::defer_lock);
+        if (&other == this) {
+            lock.lock();
+        } else {
+            std::lock(lock, otherLock);
+        }
+        if (!live.trackOverlap || !other.live.trackOverlap) {
+            return result;
+        }
+        // Sort buffered hashes in place once rather than into copies on every call
+        live.overlapSketch.compact();
+        other.live.overlapSketch.compact();
+        KMVSketch::Overlap overlap = KMVSketch::overlap(live.overlapSketch, other.live.overlapSketch);
+        result.intersection = overlap.intersection;
+        result.leftOnly = overlap.leftOnly;
+        result.rightOnly = overlap.rightOnly;
+        result.unionSize = overlap.unionSize;
+        return result;
+    }
+
+    double estimateGroupDistinct(int group) {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        return live.groups ? live.groups->estimate(group) : 0;
+    }
+
+    size_t groupCount() {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        return live.groups ? live.groups->numGroups() : 0;
+    }
+
+    void forEachGroup(const std::function<void(int, double)>& fn) {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        if (live.groups) {
+            live.groups->forEachGroup(fn);
+        }
+    }
+
+    ThetaSketch thetaSketch() {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        live.overlapSketch.compact();
+        return ThetaSketch(live.overlapSketch);
+    }
+
+    void publish() {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        publishLocked();
+    }
+
+    std::shared_ptr<const CESnapshot> snapshot() const {
+        return std::atomic_load(&published);
+    }
+
+    CEMemoryUsage memoryUsage() {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        return memoryUsageLocked();
+    }
+
+    std::vector<std::tuple<int, int>> sample() {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        return tuples;
     }
 
     void prepare() {
+        CE_TRACE_SCOPE("phase", "prepare");
+        // Batches submitted before the reset belong to the old state
+        flush();
+        std::lock_guard<std::mutex> lock(stateMutex);
         tuples.clear();
-        hll.reset();
+        tuplesSeen = 0;
+        live.reset();
+        // The published snapshot still reads the old blocks; they are recycled once it is replaced below
+        std::vector<std::shared_ptr<BlockSummary>> retired;
+        retired.swap(blocks);
+        unlocatedDeletes = 0;
+        // A resync in flight describes the data before the reset, and so does the feedback model
+        resyncGeneration++;
+        {
+            std::lock_guard<std::mutex> feedbackLock(feedbackMutex);
+            feedbackQueue.clear();
+            feedbackGeneration++;
+            std::atomic_store(&correction, std::shared_ptr<const SelectivityModel>());
+        }
+        resetPartials();
+        if (dataExecuter) {
+            loadLocked();
+        } else {
+            nextTupleId = 0;
+        }
+        if (budgetId != 0) {
+            checkBudgetLocked();
+        }
+        publishLocked();
+        // Blocks an older snapshot's reader still holds are left to that reader
+        for (auto& block : retired) {
+            if (block.use_count() == 1) {
+                std::atomic_thread_fence(std::memory_order_acquire);
+                block->reset();
+                spareBlocks.push_back(std::move(block));
+            }
+        }
     }
 };
 
-CEEngine::CEEngine() : pImpl(new Impl()) {}
+CESnapshot::CESnapshot(uint64_t version, double estimate, size_t tupleCount,
+                       std::shared_ptr<const CEQuerySummaries> summaries)
+    : snapshotVersion(version), cachedEstimate(estimate), numTuples(tupleCount),
+      querySummaries(std::move(summaries)) {}
+
+CEEngine::CEEngine() : pImpl(new Impl(CEConfig(), nullptr, 0)) {}
+CEEngine::CEEngine(const CEConfig& config) : pImpl(new Impl(config, nullptr, 0)) {}
+CEEngine::CEEngine(int num, DataExecuter* executer, const CEConfig& config)
+    : pImpl(new Impl(config, executer, num)) {}
 CEEngine::~CEEngine() = default;
 
 void CEEngine::insertTuple(const std::tuple<int, int>& tuple) {
+    CE_TIME_CALL(CEOperation::INSERT_TUPLE);
     pImpl->insertTuple(tuple);
 }
 
+void CEEngine::insertTuples(const std::vector<std::tuple<int, int>>& batch) {
+    CE_TIME_CALL(CEOperation::INSERT_TUPLES);
+    pImpl->insertTuples(batch);
+}
+
+void CEEngine::deleteTuple(const std::tuple<int, int>& tuple) {
+    CE_TIME_CALL(CEOperation::DELETE_TUPLE);
+    pImpl->deleteTuple(tuple, -1);
+}
+
+void CEEngine::deleteTuples(const std::vector<std::tuple<int, int>>& batch) {
+    CE_TIME_CALL(CEOperation::DELETE_TUPLES);
+    pImpl->deleteTuples(batch, nullptr);
+}
+
+void CEEngine::deleteTuple(const std::tuple<int, int>& tuple, int tupleId) {
+    CE_TIME_CALL(CEOperation::DELETE_TUPLE);
+    pImpl->deleteTuple(tuple, tupleId);
+}
+
+void CEEngine::deleteTuples(const std::vector<std::tuple<int, int>>& batch, const std::vector<int>& tupleIds) {
+    CE_TIME_CALL(CEOperation::DELETE_TUPLES);
+    pImpl->deleteTuples(batch, &tupleIds);
+}
+
+std::future<void> CEEngine::submit(std::vector<std::tuple<int, int>> batch) {
+    return pImpl->submit(std::move(batch));
+}
+
+bool CEEngine::trySubmit(std::vector<std::tuple<int, int>>& batch, std::future<void>& done) {
+    return pImpl->trySubmit(batch, done);
+}
+
+void CEEngine::flush() {
+    pImpl->flush();
+}
+
 double CEEngine::estimate() {
+    CE_TIME_CALL(CEOperation::ESTIMATE);
     return pImpl->estimate();
 }
 
+CEBounds CEEngine::estimateWithBounds(double numStdDevs) {
+    CE_TIME_CALL(CEOperation::ESTIMATE);
+    return pImpl->estimateWithBounds(numStdDevs);
+}
+
+double CEEngine::estimateFrequency(int columnIdx, int value) {
+    CE_TIME_CALL(CEOperation::ESTIMATE_FREQUENCY);
+    return pImpl->estimateFrequency(columnIdx, value);
+}
+
+CEBounds CEEngine::estimateFrequencyWithBounds(int columnIdx, int value) {
+    CE_TIME_CALL(CEOperation::ESTIMATE_FREQUENCY);
+    return pImpl->estimateFrequencyWithBounds(columnIdx, value);
+}
+
+CEJoinEstimate CEEngine::estimateJoin(int columnIdx, const CEEngine& other, int otherColumnIdx) {
+    CE_TIME_CALL(CEOperation::ESTIMATE_JOIN);
+    return pImpl->estimateJoin(columnIdx, *other.pImpl, otherColumnIdx);
+}
+
+CEOverlap CEEngine::estimateOverlap(const CEEngine& other) {
+    CE_TIME_CALL(CEOperation::ESTIMATE_OVERLAP);
+    return pImpl->estimateOverlap(*other.pImpl);
+}
+
+double CEEngine::estimateGroupDistinct(int group) {
+    return pImpl->estimateGroupDistinct(group);
+}
+
+size_t CEEngine::groupCount() {
+    return pImpl->groupCount();
+}
+
+void CEEngine::forEachGroup(const std::function<void(int, double)>& fn) {
+    pImpl->forEachGroup(fn);
+}
+
+ThetaSketch CEEngine::thetaSketch() {
+    return pImpl->thetaSketch();
+}
+
+void CEEngine::publish() {
+    pImpl->publish();
+}
+
+std::shared_ptr<const CESnapshot> CEEngine::snapshot() const {
+    return pImpl->snapshot();
+}
+
+bool CEEngine::resync() {
+    return pImpl->resync();
+}
+
+void CEEngine::startResync() {
+    pImpl->startResync();
+}
+
+void CEEngine::stopResync() {
+    pImpl->stopResync();
+}
+
+int CEEngine::query(const std::vector<CompareExpression>& quals, CEQueryTrace* trace) {
+    CE_TIME_CALL(CEOperation::QUERY);
+    return pImpl->query(quals, trace);
+}
+
+CEBounds CEEngine::queryWithBounds(const std::vector<CompareExpression>& quals, CEQueryTrace* trace) {
+    CE_TIME_CALL(CEOperation::QUERY);
+    return pImpl->queryWithBounds(quals, trace);
+}
+
+bool CEEngine::recordFeedback(const CEQueryTrace& trace, int trueCount) {
+    return pImpl->recordFeedback(trace, trueCount);
+}
+
+void CEEngine::flushFeedback() {
+    pImpl->flushFeedback();
+}
+
+uint64_t CEEngine::feedbackSamples() const {
+    return pImpl->feedbackSamples();
+}
+
 void CEEngine::prepare() {
     pImpl->prepare();
 }
+
+CEMemoryUsage CEEngine::memoryUsage() const {
+    return pImpl->memoryUsage();
+}
+
+std::vector<std::tuple<int, int>> CEEngine::sample() const {
+    return pImpl->sample();
+}
+
+CELatency CEEngine::latency(CEOperation op) const {
+    CELatency result;
+#ifdef CE_LATENCY_STATS
+    LatencyRecorder::Summary summary = pImpl->latencyRecorder.summary(static_cast<int>(op));
+    result.count = summary.count;
+    result.p50Nanos = summary.p50Nanos;
+    result.p99Nanos = summary.p99Nanos;
+    result.p999Nanos = summary.p999Nanos;
+    result.maxNanos = summary.maxNanos;
+#else
+    (void)op;
+#endif
+    return result;
+}
+
+void CEEngine::resetLatency() {
+#ifdef CE_LATENCY_STATS
+    pImpl->latencyRecorder.reset();
+#endif
+}
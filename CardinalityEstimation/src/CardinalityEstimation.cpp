@@ -8,3 +8,111 @@
 
 // Note: Main implementation is in CEEngine.cpp
 // This file is kept for compatibility and future extensions
+
+CEMemoryBudget::CEMemoryBudget(size_t limitBytes) : limitBytes(limitBytes) {}
+
+size_t CEMemoryBudget::used() const
+{
+    std::lock_guard<std::mutex> lock(budgetMutex);
+    return totalBytes;
+}
+
+std::vector<CEMemoryUsage> CEMemoryBudget::usage() const
+{
+    std::lock_guard<std::mutex> lock(budgetMutex);
+    std::vector<CEMemoryUsage> result;
+    for (const auto& entry : members) {
+        result.push_back(entry.second.usage);
+    }
+    return result;
+}
+
+uint64_t CEMemoryBudget::attach(Reclaim reclaim)
+{
+    std::lock_guard<std::mutex> lock(budgetMutex);
+    const uint64_t engineId = nextEngineId++;
+    members[engineId] = Member{CEMemoryUsage(), std::move(reclaim)};
+    return engineId;
+}
+
+void CEMemoryBudget::detach(uint64_t engineId)
+{
+    std::lock_guard<std::mutex> lock(budgetMutex);
+    auto it = members.find(engineId);
+    if (it != members.end()) {
+        totalBytes -= it->second.usage.total();
+        members.erase(it);
+    }
+}
+
+size_t CEMemoryBudget::report(uint64_t engineId, const CEMemoryUsage& usage)
+{
+    // Reclaim callbacks only try-lock their engine, so holding budgetMutex (and the reporter's own engine lock)
+    // while calling them cannot deadlock; detach() waits here, so no callback outlives its engine
+    std::lock_guard<std::mutex> lock(budgetMutex);
+    Member& reporter = members[engineId];
+    totalBytes = totalBytes - reporter.usage.total() + usage.total();
+    reporter.usage = usage;
+    if (totalBytes <= limitBytes) {
+        return 0;
+    }
+    const size_t share = limitBytes / members.size();
+
+    // Largest engines over their share first
+    std::vector<std::pair<size_t, Member*>> over;
+    for (auto& entry : members) {
+        const size_t bytes = entry.second.usage.total();
+        if (entry.first != engineId && bytes > share && entry.second.reclaim) {
+            over.emplace_back(bytes, &entry.second);
+        }
+    }
+    std::sort(over.begin(), over.end(), [](const std::pair<size_t, Member*>& a, const std::pair<size_t, Member*>& b) {
+        return a.first > b.first;
+    });
+    for (const auto& entry : over) {
+        if (totalBytes <= limitBytes) {
+            break;
+        }
+        Member& member = *entry.second;
+        CEMemoryUsage after;
+        if (member.reclaim(std::min(totalBytes - limitBytes, entry.first - share), after)) {
+            totalBytes = totalBytes - member.usage.total() + after.total();
+            member.usage = after;
+        }
+    }
+
+    if (totalBytes <= limitBytes || usage.total() <= share) {
+        return 0;
+    }
+    return std::min(totalBytes - limitBytes, usage.total() - share);
+}
+
+CEEnginePool::CEEnginePool(const CEConfig& config, size_t maxIdle) : config(config), maxIdle(maxIdle)
+{
+    engines.reserve(maxIdle);
+}
+
+std::unique_ptr<CEEngine> CEEnginePool::acquire()
+{
+    if (engines.empty()) {
+        return std::unique_ptr<CEEngine>(new CEEngine(config));
+    }
+    std::unique_ptr<CEEngine> engine = std::move(engines.back());
+    engines.pop_back();
+    return engine;
+}
+
+void CEEnginePool::release(std::unique_ptr<CEEngine> engine)
+{
+    if (!engine || engines.size() >= maxIdle) {
+        return;
+    }
+    engine->prepare();
+    engines.push_back(std::move(engine));
+}
+
+CEEnginePool& CEEnginePool::local()
+{
+    static thread_local CEEnginePool pool;
+    return pool;
+}
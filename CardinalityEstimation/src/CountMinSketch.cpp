@@ -0,0 +1,138 @@
+#include "engine/CountMinSketch.h"
+#include "xxhash/xxhash.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+CountMinSketch::CountMinSketch(int depth, int widthBits)
+    : counters(static_cast<size_t>(depth) << widthBits), rows(depth), widthBits(widthBits)
+{
+    touched.assign((counters.size() + (size_t(1) << kBlockShift) - 1) >> kBlockShift);
+}
+
+void CountMinSketch::zeroBlock(size_t block)
+{
+    const size_t begin = block << kBlockShift;
+    std::memset(counters.data() + begin, 0,
+                std::min(size_t(1) << kBlockShift, counters.size() - begin) * sizeof(int32_t));
+    touched.mark(block);
+}
+
+uint64_t CountMinSketch::hash(uint64_t key)
+{
+    return XXHash64(&key, sizeof(key), 0x5bd1e995);
+}
+
+void CountMinSketch::add(uint64_t key, int32_t delta)
+{
+    addHashed(hash(key), delta);
+}
+
+void CountMinSketch::addHashed(uint64_t h, int32_t delta)
+{
+    for (int row = 0; row < rows; ++row) {
+        counterAt((static_cast<size_t>(row) << widthBits) + column(h, row)) += delta;
+    }
+    totalCount += delta;
+}
+
+void CountMinSketch::addBatch(const uint64_t* keys, size_t n, int32_t delta)
+{
+    std::vector<uint64_t> hashes(n);
+    for (size_t i = 0; i < n; ++i) {
+        hashes[i] = hash(keys[i]);
+    }
+    for (int row = 0; row < rows; ++row) {
+        addHashedRow(row, hashes.data(), n, delta);
+    }
+    totalCount += static_cast<int64_t>(n) * delta;
+}
+
+void CountMinSketch::addHashedRow(int row, const uint64_t* hashes, size_t n, int32_t delta)
+{
+    const size_t rowStart = static_cast<size_t>(row) << widthBits;
+    for (size_t i = 0; i < n; ++i) {
+        counterAt(rowStart + column(hashes[i], row)) += delta;
+    }
+}
+
+int64_t CountMinSketch::estimate(uint64_t key) const
+{
+    uint64_t h = hash(key);
+    int64_t best = std::numeric_limits<int64_t>::max();
+    for (int row = 0; row < rows; ++row) {
+        best = std::min<int64_t>(best, counterValue((static_cast<size_t>(row) << widthBits) + column(h, row)));
+    }
+    return best;
+}
+
+double CountMinSketch::maxOvercount() const
+{
+    return std::exp(1.0) / static_cast<double>(width()) * static_cast<double>(std::max<int64_t>(0, totalCount));
+}
+
+std::vector<double> CountMinSketch::rowInnerProducts(const CountMinSketch& other) const
+{
+    const CountMinSketch& wide = widthBits >= other.widthBits ? *this : other;
+    const CountMinSketch& narrow = widthBits >= other.widthBits ? other : *this;
+    const size_t narrowWidth = narrow.width();
+    const size_t blockSize = size_t(1) << kBlockShift;
+    std::vector<double> products(std::min(rows, other.rows), 0);
+    std::vector<int64_t> folded;
+    for (size_t row = 0; row < products.size(); ++row) {
+        const size_t narrowStart = row << narrow.widthBits;
+        const size_t wideStart = row << wide.widthBits;
+        double sum = 0;
+        if (wide.widthBits == narrow.widthBits && narrowWidth >= blockSize) {
+            // Equal widths: only blocks written in both sketches contribute
+            for (size_t i = narrowStart; i < narrowStart + narrowWidth; i += blockSize) {
+                if (!wide.touched.dirty(i >> kBlockShift) || !narrow.touched.dirty(i >> kBlockShift)) {
+                    continue;
+                }
+                for (size_t k = i; k < i + blockSize; ++k) {
+                    sum += static_cast<double>(wide.counters[k]) * narrow.counters[k];
+                }
+            }
+        } else {
+            folded.assign(narrowWidth, 0);
+            for (size_t c = 0; c < wide.width(); ++c) {
+                folded[c & (narrowWidth - 1)] += wide.counterValue(wideStart + c);
+            }
+            for (size_t c = 0; c < narrowWidth; ++c) {
+                sum += static_cast<double>(folded[c]) * narrow.counterValue(narrowStart + c);
+            }
+        }
+        products[row] = sum;
+    }
+    return products;
+}
+
+void CountMinSketch::reset()
+{
+    touched.clear();
+    totalCount = 0;
+}
+
+void CountMinSketch::shrinkWidth(int bits)
+{
+    if (bits >= widthBits || bits < 0) {
+        return;
+    }
+    const size_t newWidth = size_t(1) << bits;
+    std::vector<int32_t> folded(static_cast<size_t>(rows) * newWidth, 0);
+    touched.forEachDirty([&](size_t block) {
+        const size_t begin = block << kBlockShift;
+        const size_t end = std::min(begin + (size_t(1) << kBlockShift), counters.size());
+        for (size_t i = begin; i < end; ++i) {
+            const size_t row = i >> widthBits;
+            folded[row * newWidth + (i & (newWidth - 1))] += counters[i];
+        }
+    });
+    counters.swap(folded);
+    widthBits = bits;
+    // The folded counters are all written
+    const size_t numBlocks = (counters.size() + (size_t(1) << kBlockShift) - 1) >> kBlockShift;
+    touched.assign(numBlocks);
+    touched.markFirst(numBlocks);
+}
@@ -3,50 +3,200 @@
 //
 
 #include <executer/DataExecuterDemo.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
 
-std::unordered_map<int, bool> vis;
-DataExecuterDemo::DataExecuterDemo(int end, int count) : DataExecuter()
+namespace {
+    // Zones per scan task, so each task reads 64K rows
+    const size_t kZonesPerTask = 16;
+}
+
+// Helper threads that, with the calling thread, pull scan tasks off a shared counter. The oracle keeps its own
+// threads rather than the engine's pool, so exact answers don't depend on the estimator's scheduling.
+class DataExecuterDemo::ScanThreads {
+public:
+    explicit ScanThreads(int numThreads)
+    {
+        for (int i = 1; i < numThreads; ++i) {
+            threads.emplace_back([this] { work(); });
+        }
+    }
+
+    ~ScanThreads()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto &thread : threads) {
+            thread.join();
+        }
+    }
+
+    // Run fn(task) for every task in [0, numTasks) and return once all have finished
+    void parallelFor(size_t numTasks, const std::function<void(size_t)> &fn)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &fn;
+            jobTasks = numTasks;
+            next = 0;
+            busy = threads.size();
+            generation++;
+        }
+        wake.notify_all();
+        drain(fn, numTasks);
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return busy == 0; });
+        job = nullptr;
+    }
+
+private:
+    void drain(const std::function<void(size_t)> &fn, size_t numTasks)
+    {
+        for (size_t task = next.fetch_add(1); task < numTasks; task = next.fetch_add(1)) {
+            fn(task);
+        }
+    }
+
+    void work()
+    {
+        uint64_t seen = 0;
+        for (;;) {
+            const std::function<void(size_t)> *fn;
+            size_t numTasks;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) {
+                    return;
+                }
+                seen = generation;
+                fn = job;
+                numTasks = jobTasks;
+            }
+            drain(*fn, numTasks);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--busy == 0) {
+                done.notify_one();
+            }
+        }
+    }
+
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake;  // new job, or stop
+    std::condition_variable done;  // every helper left the current job
+    const std::function<void(size_t)> *job = nullptr;
+    size_t jobTasks = 0;
+    std::atomic<size_t> next{0};
+    size_t busy = 0;  // helpers not yet done with the current job
+    uint64_t generation = 0;
+    bool stopping = false;
+};
+
+DataExecuterDemo::DataExecuterDemo(int end, int count, const DataSpec &spec, uint64_t seed)
+    : DataExecuter(), generator(spec, seed)
 {
     this->end = end;
     this->count = count;
+    std::vector<std::tuple<int, int>> base = generator.generate(end + 1);
+    for (const auto &tuple : base) {
+        append(std::get<0>(tuple), std::get<1>(tuple));
+    }
+    deleted.assign(numRows / 64 + 1, 0);
     for (int i = 0; i <= end; ++i) {
-        std::vector<int> tuple;
-        tuple.push_back(rand());
-        tuple.push_back(rand());
-        set.push_back(tuple);
+        addToZone(i);
+    }
+}
+
+DataExecuterDemo::~DataExecuterDemo() = default;
+
+void DataExecuterDemo::setScanThreads(int numThreads)
+{
+    pool.reset(numThreads > 1 ? new ScanThreads(numThreads) : nullptr);
+}
+
+void DataExecuterDemo::append(int32_t a, int32_t b)
+{
+    if ((numRows & (kChunkRows - 1)) == 0) {
+        for (int c = 0; c < kNumColumns; ++c) {
+            chunks[c].emplace_back(new int32_t[kChunkRows]);
+        }
     }
+    const int offset = numRows & (kChunkRows - 1);
+    chunks[0].back()[offset] = a;
+    chunks[1].back()[offset] = b;
+    numRows++;
+}
+
+void DataExecuterDemo::addToZone(int tupleId)
+{
+    size_t z = static_cast<size_t>(tupleId) >> kZoneBits;
+    if (z >= zones.size()) {
+        zones.resize(z + 1);
+    }
+    Zone &zone = zones[z];
+    for (int c = 0; c < kNumColumns; ++c) {
+        zone.minValue[c] = std::min(zone.minValue[c], value(c, tupleId));
+        zone.maxValue[c] = std::max(zone.maxValue[c], value(c, tupleId));
+    }
+    zone.live++;
 }
 
 std::vector<int> DataExecuterDemo::generateInsert()
 {
+    std::tuple<int, int> next = generator.next();
     std::vector<int> tuple;
-    tuple.push_back(rand());
-    tuple.push_back(rand());
-    set.push_back(tuple);
+    tuple.push_back(std::get<0>(next));
+    tuple.push_back(std::get<1>(next));
+    append(tuple[0], tuple[1]);
+    if (static_cast<size_t>(numRows) > deleted.size() * 64) {
+        deleted.push_back(0);
+    }
     end++;
+    addToZone(end);
     return tuple;
 }
 
 int DataExecuterDemo::generateDelete()
 {
-    int x = (rand()) % end;
-    while (vis[x]) {
-        x = (rand()) % end;
+    int x = static_cast<int>(generator.uniform(end));
+    while (isDeleted(x)) {
+        x = static_cast<int>(generator.uniform(end));
     }
-    vis[x] = true;
+    markDeleted(x);
     return x;
 }
 
 void DataExecuterDemo::readTuples(int start, int offset, std::vector<std::vector<int>> &vec)
 {
-    for (int i = start; i < start + offset; ++i) {
-        if (!vis[i]) {
-            vec.push_back(set[i]);
+    const int last = std::min(start + offset, numRows);
+    for (int i = std::max(start, 0); i < last; ++i) {
+        if (!isDeleted(i)) {
+            vec.push_back({value(0, i), value(1, i)});
         }
     }
     return;
 };
 
+void DataExecuterDemo::deleteTuples(const std::vector<int> &tupleIds, std::vector<std::tuple<int, int>> &removed)
+{
+    removed.reserve(removed.size() + tupleIds.size());
+    for (int id : tupleIds) {
+        if (id < 0 || id >= numRows || isDeleted(id)) {
+            continue;
+        }
+        markDeleted(id);
+        removed.emplace_back(value(0, id), value(1, id));
+    }
+}
+
 Action DataExecuterDemo::getNextAction()
 {
     Action action;
@@ -56,7 +206,11 @@ Action DataExecuterDemo::getNextAction()
     }
     if (count % 100 == 99) {
         action.actionType = QUERY;
-        CompareExpression expr = {rand() % 2, CompareOp(rand() % 2), rand()};
+        // Constants come from the data distribution, so equality queries on skewed data hit the common values
+        int columnIdx = static_cast<int>(generator.uniform(2));
+        CompareOp op = CompareOp(generator.uniform(2));
+        std::tuple<int, int> sample = generator.next();
+        CompareExpression expr = {columnIdx, op, columnIdx == 0 ? std::get<0>(sample) : std::get<1>(sample)};
         action.quals.push_back(expr);
     } else if (count % 100 < 90) {
         action.actionType = INSERT;
@@ -64,34 +218,96 @@ Action DataExecuterDemo::getNextAction()
     } else {
         action.actionType = DELETE;
         action.tupleId = generateDelete();
-        action.actionTuple = set[action.tupleId];
+        action.actionTuple = {value(0, action.tupleId), value(1, action.tupleId)};
     }
     count--;
     curAction = action;
     return action;
 };
 
-double DataExecuterDemo::answer(int ans)
+int DataExecuterDemo::scanZone(int first, int rows, const std::vector<CompareExpression> &quals) const
 {
+    // Column at a time: each qual narrows a byte mask in a branch-free loop the compiler vectorizes. A zone starts
+    // on a 64-row boundary, so its deletion bits are whole words.
+    uint8_t mask[kZoneRows];
+    const uint64_t *words = deleted.data() + (first >> 6);
+    for (int i = 0; i < rows; ++i) {
+        mask[i] = static_cast<uint8_t>(~(words[i >> 6] >> (i & 63)) & 1);
+    }
+    for (const CompareExpression &expr : quals) {
+        const int32_t *column = columnAt(expr.columnIdx, first);
+        const int32_t value = expr.value;
+        if (expr.compareOp == GREATER) {
+            for (int i = 0; i < rows; ++i) {
+                mask[i] &= column[i] > value;
+            }
+        } else if (expr.compareOp == EQUAL) {
+            for (int i = 0; i < rows; ++i) {
+                mask[i] &= column[i] == value;
+            }
+        }
+    }
     int cnt = 0;
-    for (int i = 0; i <= end; ++i) {
-        if (vis[i])
-            continue;
-        bool flag = true;
-        for (int j = 0; j < curAction.quals.size(); ++j) {
-            CompareExpression &expr = curAction.quals[j];
-            if (expr.compareOp == GREATER && set[i][expr.columnIdx] <= expr.value) {
-                flag = false;
-                break;
+    for (int i = 0; i < rows; ++i) {
+        cnt += mask[i];
+    }
+    return cnt;
+}
+
+int DataExecuterDemo::countMatches(const std::vector<CompareExpression> &quals) const
+{
+    auto countZones = [&](size_t firstZone, size_t lastZone) {
+        int cnt = 0;
+        for (size_t z = firstZone; z < lastZone; ++z) {
+            const Zone &zone = zones[z];
+            if (zone.live == 0) {
+                continue;
+            }
+            bool none = false;
+            bool all = true;
+            for (const CompareExpression &expr : quals) {
+                const int lo = zone.minValue[expr.columnIdx];
+                const int hi = zone.maxValue[expr.columnIdx];
+                if (expr.compareOp == GREATER) {
+                    none = none || hi <= expr.value;
+                    all = all && lo > expr.value;
+                } else if (expr.compareOp == EQUAL) {
+                    none = none || expr.value < lo || expr.value > hi;
+                    all = all && lo == expr.value && hi == expr.value;
+                }
             }
-            if (expr.compareOp == EQUAL && set[i][expr.columnIdx] != expr.value) {
-                flag = false;
-                break;
+            if (none) {
+                continue;
             }
+            if (all) {
+                cnt += zone.live;
+                continue;
+            }
+            // A zone never straddles a chunk, so each column of the zone is one contiguous array
+            const int first = static_cast<int>(z << kZoneBits);
+            cnt += scanZone(first, std::min(numRows, first + kZoneRows) - first, quals);
         }
-        if (flag)
-            cnt++;
+        return cnt;
+    };
+
+    const size_t numTasks = (zones.size() + kZonesPerTask - 1) / kZonesPerTask;
+    if (!pool || numTasks < 2) {
+        return countZones(0, zones.size());
+    }
+    std::vector<int> counts(numTasks);
+    pool->parallelFor(numTasks, [&](size_t task) {
+        counts[task] = countZones(task * kZonesPerTask, std::min(zones.size(), (task + 1) * kZonesPerTask));
+    });
+    int cnt = 0;
+    for (int c : counts) {
+        cnt += c;
     }
+    return cnt;
+}
+
+double DataExecuterDemo::answer(int ans)
+{
+    int cnt = countMatches(curAction.quals);
     double error = fabs(std::log((ans + 1) * 1.0 / (cnt + 1)));
     return error;
 };
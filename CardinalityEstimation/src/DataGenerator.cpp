@@ -0,0 +1,124 @@
+#include <executer/DataGenerator.h>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    const uint32_t kMaxZipfValues = 1u << 22;
+
+    inline uint64_t splitMix64(uint64_t& state)
+    {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+}
+
+Xoshiro256::Xoshiro256(uint64_t seed)
+{
+    for (uint64_t& word : s) {
+        word = splitMix64(seed);
+    }
+}
+
+DataGenerator::DataGenerator(const DataSpec& spec, uint64_t seed)
+    : dataSpec(spec), rng(seed), valueRange(static_cast<uint32_t>(std::max(spec.maxValue, 0)) + 1)
+{
+    if (spec.distribution == Distribution::ZIPF) {
+        buildZipf();
+    } else if (spec.distribution == Distribution::DUPLICATES) {
+        pool.resize(std::max(spec.distinctTuples, 1));
+        for (auto& tuple : pool) {
+            uint64_t x = rng.next();
+            tuple = std::make_tuple(static_cast<int>(rng.reduce(static_cast<uint32_t>(x >> 32), valueRange)),
+                                    static_cast<int>(rng.reduce(static_cast<uint32_t>(x), valueRange)));
+        }
+    }
+}
+
+void DataGenerator::buildZipf()
+{
+    const uint32_t n = std::min(valueRange, kMaxZipfValues);
+    std::vector<double> scaled(n);
+    double total = 0;
+    for (uint32_t k = 0; k < n; ++k) {
+        scaled[k] = std::pow(k + 1.0, -dataSpec.zipfS);
+        total += scaled[k];
+    }
+    std::vector<uint32_t> small, large;
+    for (uint32_t k = 0; k < n; ++k) {
+        scaled[k] *= n / total;
+        (scaled[k] < 1.0 ? small : large).push_back(k);
+    }
+    aliasTable.resize(n);
+    for (uint32_t k = 0; k < n; ++k) {
+        aliasTable[k] = AliasEntry{UINT32_MAX, static_cast<int>(k)};
+    }
+    while (!small.empty() && !large.empty()) {
+        uint32_t s = small.back();
+        uint32_t l = large.back();
+        small.pop_back();
+        aliasTable[s] = AliasEntry{static_cast<uint32_t>(scaled[s] * 4294967296.0), static_cast<int>(l)};
+        scaled[l] -= 1.0 - scaled[s];
+        if (scaled[l] < 1.0) {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+    // Whatever is left is 1.0 up to rounding and keeps its own value
+}
+
+void DataGenerator::fill(std::tuple<int, int>* out, size_t n)
+{
+    // One branch per batch; each loop draws a single 64-bit value per column pair where it can
+    switch (dataSpec.distribution) {
+    case Distribution::UNIFORM:
+        for (size_t i = 0; i < n; ++i) {
+            uint64_t x = rng.next();
+            out[i] = std::make_tuple(static_cast<int>(rng.reduce(static_cast<uint32_t>(x >> 32), valueRange)),
+                                     static_cast<int>(rng.reduce(static_cast<uint32_t>(x), valueRange)));
+        }
+        break;
+    case Distribution::ZIPF:
+        for (size_t i = 0; i < n; ++i) {
+            int a = zipfValue(rng.next());
+            int b = zipfValue(rng.next());
+            out[i] = std::make_tuple(a, b);
+        }
+        break;
+    case Distribution::CORRELATED: {
+        const uint32_t spread = static_cast<uint32_t>(std::max(dataSpec.correlationSpread, 0)) + 1;
+        for (size_t i = 0; i < n; ++i) {
+            uint64_t x = rng.next();
+            int64_t a = rng.reduce(static_cast<uint32_t>(x >> 32), valueRange);
+            int64_t b = std::min<int64_t>(INT_MAX, a + rng.reduce(static_cast<uint32_t>(x), spread));
+            out[i] = std::make_tuple(static_cast<int>(a), static_cast<int>(b));
+        }
+        break;
+    }
+    case Distribution::SEQUENTIAL:
+        for (size_t i = 0; i < n; ++i) {
+            // Wraps around like the int counters it replaces
+            uint32_t a = static_cast<uint32_t>(dataSpec.start + sequence++);
+            out[i] = std::make_tuple(static_cast<int>(a), static_cast<int>(a + 1));
+        }
+        break;
+    case Distribution::CONSTANT:
+        std::fill(out, out + n, std::make_tuple(dataSpec.start, dataSpec.start));
+        break;
+    case Distribution::DUPLICATES: {
+        const uint32_t size = static_cast<uint32_t>(pool.size());
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = pool[rng.bounded(size)];
+        }
+        break;
+    }
+    }
+}
+
+std::vector<std::tuple<int, int>> DataGenerator::generate(size_t n)
+{
+    std::vector<std::tuple<int, int>> tuples(n);
+    fill(tuples.data(), n);
+    return tuples;
+}
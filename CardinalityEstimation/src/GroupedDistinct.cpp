@@ -0,0 +1,279 @@
+#include "engine/GroupedDistinct.h"
+#include "engine/CountMinSketch.h"
+#include <algorithm>
+#include <cmath>
+
+GroupedDistinct::GroupedDistinct(int bits)
+    : registerBits(std::max(6, std::min(18, bits))),
+      maxSizeClass(static_cast<uint8_t>(registerBits - 4)),
+      freeRuns(static_cast<size_t>(registerBits - 3))
+{
+}
+
+uint64_t GroupedDistinct::hashValue(int value)
+{
+    return CountMinSketch::hash(static_cast<uint32_t>(value));
+}
+
+const GroupedDistinct::Group* GroupedDistinct::find(int group) const
+{
+    if (table.empty()) {
+        return nullptr;
+    }
+    for (size_t i = home(group); table[i].used; i = (i + 1) & mask) {
+        if (table[i].key == group) {
+            return &table[i];
+        }
+    }
+    return nullptr;
+}
+
+GroupedDistinct::Group& GroupedDistinct::findOrInsert(int group)
+{
+    if ((numUsed + 1) * 4 > table.size() * 3) {
+        growTable();
+    }
+    size_t i = home(group);
+    while (table[i].used) {
+        if (table[i].key == group) {
+            return table[i];
+        }
+        i = (i + 1) & mask;
+    }
+    // Allocate first: compacting the arena walks the groups in use
+    const uint32_t offset = allocateRun(0);
+    Group& g = table[i];
+    g.key = group;
+    g.used = true;
+    g.dense = false;
+    g.sizeClass = 0;
+    g.size = 0;
+    g.sorted = 0;
+    g.offset = offset;
+    numUsed++;
+    return g;
+}
+
+void GroupedDistinct::growTable()
+{
+    std::vector<Group> previous(std::max<size_t>(64, table.size() * 2));
+    previous.swap(table);
+    mask = table.size() - 1;
+    for (const Group& g : previous) {
+        if (g.used) {
+            size_t i = home(g.key);
+            while (table[i].used) {
+                i = (i + 1) & mask;
+            }
+            table[i] = g;
+        }
+    }
+}
+
+uint32_t GroupedDistinct::allocateRun(uint8_t sizeClass)
+{
+    std::vector<uint32_t>& released = freeRuns[sizeClass];
+    if (!released.empty()) {
+        uint32_t offset = released.back();
+        released.pop_back();
+        freeWords -= kMinRun << sizeClass;
+        return offset;
+    }
+    // Groups mostly grow, so released runs pile up in the smaller classes; drop them rather than grow the arena
+    // while they are at least a quarter of it
+    const size_t needed = sparseArena.size() + (kMinRun << sizeClass);
+    if (needed > sparseArena.capacity() && freeWords * 4 >= sparseArena.size()) {
+        compactArena();
+    }
+    const uint32_t offset = static_cast<uint32_t>(sparseArena.size());
+    sparseArena.resize(sparseArena.size() + (kMinRun << sizeClass));
+    return offset;
+}
+
+void GroupedDistinct::freeRun(uint8_t sizeClass, uint32_t offset)
+{
+    freeRuns[sizeClass].push_back(offset);
+    freeWords += kMinRun << sizeClass;
+}
+
+void GroupedDistinct::compactArena()
+{
+    std::vector<uint32_t> compacted;
+    const size_t live = sparseArena.size() - freeWords;
+    compacted.reserve(live + live / 2);
+    for (Group& g : table) {
+        if (g.used && !g.dense) {
+            const uint32_t offset = static_cast<uint32_t>(compacted.size());
+            compacted.insert(compacted.end(), sparseArena.begin() + g.offset,
+                             sparseArena.begin() + g.offset + (kMinRun << g.sizeClass));
+            g.offset = offset;
+        }
+    }
+    sparseArena.swap(compacted);
+    for (auto& released : freeRuns) {
+        released.clear();
+    }
+    freeWords = 0;
+}
+
+void GroupedDistinct::add(int group, uint64_t valueHash)
+{
+    addToGroup(findOrInsert(group), valueHash);
+}
+
+void GroupedDistinct::addBatch(const std::vector<std::tuple<int, int>>& tuples, const uint64_t* valueHashes)
+{
+    for (size_t i = 0; i < tuples.size(); ++i) {
+        const uint64_t hash = valueHashes ? valueHashes[i] : hashValue(std::get<1>(tuples[i]));
+        addToGroup(findOrInsert(std::get<0>(tuples[i])), hash);
+    }
+}
+
+void GroupedDistinct::addToGroup(Group& g, uint64_t valueHash)
+{
+    if (g.dense) {
+        // Same register index and rank as HyperLogLog::addHash
+        const uint32_t idx = static_cast<uint32_t>(valueHash >> (64 - registerBits));
+        const uint64_t rest = (valueHash << registerBits) | (UINT64_C(1) << (registerBits - 1));
+        uint8_t& reg = denseArena[(static_cast<size_t>(g.offset) << registerBits) + idx];
+        reg = std::max(reg, static_cast<uint8_t>(1 + countLeadingZeros(rest)));
+        return;
+    }
+    // The same split at kSparseBits; ranks go up to 40, so pairs fit in 31 bits
+    const uint32_t idx = static_cast<uint32_t>(valueHash >> (64 - kSparseBits));
+    const uint64_t rest = (valueHash << kSparseBits) | (UINT64_C(1) << (kSparseBits - 1));
+    const uint32_t pair = (idx << 6) | static_cast<uint32_t>(1 + countLeadingZeros(rest));
+    // Repeats of the value just added are common and need no room
+    if (g.size > 0 && sparseArena[g.offset + g.size - 1] == pair) {
+        return;
+    }
+    if (g.size == (kMinRun << g.sizeClass)) {
+        makeRoom(g);
+        if (g.dense) {
+            addToGroup(g, valueHash);
+            return;
+        }
+    }
+    sparseArena[g.offset + g.size++] = pair;
+}
+
+void GroupedDistinct::makeRoom(Group& g)
+{
+    uint32_t* run = sparseArena.data() + g.offset;
+    std::sort(run + g.sorted, run + g.size);
+    std::inplace_merge(run, run + g.sorted, run + g.size);
+    // Pairs sort by index, then rank; keep the last (highest rank) pair of every index
+    uint32_t out = 0;
+    for (uint32_t i = 0; i < g.size; ++i) {
+        if (i + 1 < g.size && (run[i + 1] >> 6) == (run[i] >> 6)) {
+            continue;
+        }
+        run[out++] = run[i];
+    }
+    g.size = out;
+    g.sorted = out;
+
+    const uint32_t capacity = kMinRun << g.sizeClass;
+    if (g.size * 4 < capacity * 3) {
+        return;
+    }
+    if (g.sizeClass == maxSizeClass) {
+        promote(g);
+        return;
+    }
+    const uint32_t offset = allocateRun(static_cast<uint8_t>(g.sizeClass + 1));
+    std::copy(sparseArena.begin() + g.offset, sparseArena.begin() + g.offset + g.size, sparseArena.begin() + offset);
+    freeRun(g.sizeClass, g.offset);
+    g.offset = offset;
+    g.sizeClass++;
+}
+
+void GroupedDistinct::promote(Group& g)
+{
+    const size_t number = denseCount++;
+    denseArena.resize(denseCount << registerBits, 0);
+    uint8_t* registers = denseArena.data() + (number << registerBits);
+    for (uint32_t i = 0; i < g.size; ++i) {
+        uint32_t idx;
+        uint8_t rank;
+        denseRegister(sparseArena[g.offset + i], idx, rank);
+        registers[idx] = std::max(registers[idx], rank);
+    }
+    freeRun(g.sizeClass, g.offset);
+    g.dense = true;
+    g.offset = static_cast<uint32_t>(number);
+    g.size = 0;
+    g.sorted = 0;
+    // Promoted groups leave their largest runs behind, and no sparse group may grow into them for a while
+    if (freeWords * 2 >= sparseArena.size()) {
+        compactArena();
+    }
+}
+
+void GroupedDistinct::denseRegister(uint32_t pair, uint32_t& idx, uint8_t& rank) const
+{
+    // The sparse index bits below the dense index are the first bits of the dense rank's suffix
+    const int extraBits = kSparseBits - registerBits;
+    const uint32_t sparseIdx = pair >> 6;
+    const uint32_t extra = sparseIdx & ((1u << extraBits) - 1);
+    idx = sparseIdx >> extraBits;
+    if (extra != 0) {
+        int width = 0;
+        for (uint32_t x = extra; x != 0; x >>= 1) {
+            width++;
+        }
+        rank = static_cast<uint8_t>(extraBits - width + 1);
+    } else {
+        rank = static_cast<uint8_t>(extraBits + (pair & 63));
+    }
+}
+
+double GroupedDistinct::estimateGroup(const Group& g) const
+{
+    if (g.dense) {
+        int counts[66] = {};
+        const uint8_t* registers = denseArena.data() + (static_cast<size_t>(g.offset) << registerBits);
+        for (int i = 0; i < (1 << registerBits); ++i) {
+            counts[registers[i]]++;
+        }
+        return HyperLogLog::estimateHistogram(counts, registerBits, HLLEstimator::CLASSIC);
+    }
+    // Linear counting over the 2^kSparseBits sparse indices; deduplicate a copy so the run itself stays untouched
+    std::vector<uint32_t> indices(g.size);
+    for (uint32_t i = 0; i < g.size; ++i) {
+        indices[i] = sparseArena[g.offset + i] >> 6;
+    }
+    std::sort(indices.begin(), indices.end());
+    const double hit = static_cast<double>(std::unique(indices.begin(), indices.end()) - indices.begin());
+    const double slots = static_cast<double>(1u << kSparseBits);
+    return slots * std::log(slots / (slots - hit));
+}
+
+double GroupedDistinct::estimate(int group) const
+{
+    const Group* g = find(group);
+    return g ? estimateGroup(*g) : 0;
+}
+
+size_t GroupedDistinct::memoryUsage() const
+{
+    size_t bytes = sizeof(*this) + table.capacity() * sizeof(Group) + sparseArena.capacity() * sizeof(uint32_t) +
+                   denseArena.capacity();
+    for (const auto& released : freeRuns) {
+        bytes += released.capacity() * sizeof(uint32_t);
+    }
+    return bytes;
+}
+
+void GroupedDistinct::reset()
+{
+    std::fill(table.begin(), table.end(), Group());
+    numUsed = 0;
+    sparseArena.clear();
+    for (auto& released : freeRuns) {
+        released.clear();
+    }
+    freeWords = 0;
+    denseArena.clear();
+    denseCount = 0;
+}
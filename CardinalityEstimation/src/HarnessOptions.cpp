@@ -0,0 +1,154 @@
+#include "harness/HarnessOptions.h"
+#include "engine/NumaTopology.h"
+#include "engine/Tracer.h"
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace {
+    // Decimal, or hexadecimal with an explicit 0x prefix. A leading zero does not mean octal, so the seed typed is
+    // the seed used; signs, whitespace and out-of-range values are rejected.
+    bool parseUnsigned(const char* text, uint64_t& value)
+    {
+        if (!text || !std::isdigit(static_cast<unsigned char>(text[0]))) {
+            return false;
+        }
+        const bool hex = text[0] == '0' && (text[1] == 'x' || text[1] == 'X');
+        const char* digits = hex ? text + 2 : text;
+        if (!std::isxdigit(static_cast<unsigned char>(digits[0]))) {
+            return false;
+        }
+        errno = 0;
+        char* end = nullptr;
+        const uint64_t parsed = std::strtoull(digits, &end, hex ? 16 : 10);
+        if (*end != '\0' || errno == ERANGE) {
+            return false;
+        }
+        value = parsed;
+        return true;
+    }
+
+    bool parseInt(const char* text, int& value)
+    {
+        uint64_t parsed;
+        if (!parseUnsigned(text, parsed) || parsed > 1u << 30) {
+            return false;
+        }
+        value = static_cast<int>(parsed);
+        return true;
+    }
+
+    bool invalid(const char* name, const char* text)
+    {
+        std::cerr << "Invalid value for " << name << ": " << (text ? text : "(missing)") << std::endl;
+        return false;
+    }
+}
+
+bool HarnessOptions::parse(int argc, char** argv)
+{
+    if (const char* env = std::getenv("CE_SEED")) {
+        if (!parseUnsigned(env, seed)) {
+            return invalid("CE_SEED", env);
+        }
+        seedSource = "CE_SEED";
+    }
+    if (const char* env = std::getenv("CE_PIN_CPU")) {
+        if (!parseInt(env, pinCpu)) {
+            return invalid("CE_PIN_CPU", env);
+        }
+    }
+    if (const char* env = std::getenv("CE_WARMUP")) {
+        if (!parseInt(env, warmupRuns)) {
+            return invalid("CE_WARMUP", env);
+        }
+    }
+    if (const char* env = std::getenv("CE_TRACE")) {
+        tracePath = env;
+    }
+
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        // Accept both "--flag value" and "--flag=value"
+        const char* value = std::strchr(arg, '=');
+        std::string flag = value ? std::string(arg, value - arg) : std::string(arg);
+        if (flag != "--seed" && flag != "--pin" && flag != "--warmup" && flag != "--trace") {
+            positional.push_back(arg);
+            continue;
+        }
+        if (value) {
+            value++;
+        } else {
+            value = i + 1 < argc ? argv[++i] : nullptr;
+        }
+        if (flag == "--seed") {
+            if (!parseUnsigned(value, seed)) {
+                return invalid("--seed", value);
+            }
+            seedSource = "--seed";
+        } else if (flag == "--trace") {
+            if (!value || !*value) {
+                return invalid("--trace", value);
+            }
+            tracePath = value;
+        } else if (flag == "--pin") {
+            if (!parseInt(value, pinCpu)) {
+                return invalid("--pin", value);
+            }
+        } else if (!parseInt(value, warmupRuns)) {
+            return invalid("--warmup", value);
+        }
+    }
+    return true;
+}
+
+bool HarnessOptions::pinCurrentThread() const
+{
+    return pinCpu < 0 || NumaTopology::pinCurrentThread({pinCpu});
+}
+
+bool HarnessOptions::startTrace() const
+{
+    if (tracePath.empty()) {
+        return true;
+    }
+#ifdef CE_TRACING
+    Tracer::global().start();
+    return true;
+#else
+    std::cerr << "Tracing is compiled out; rebuild with -DCE_TRACING=ON to write " << tracePath << std::endl;
+    return false;
+#endif
+}
+
+bool HarnessOptions::finishTrace() const
+{
+    if (tracePath.empty() || !Tracer::global().enabled()) {
+        return true;
+    }
+    Tracer::global().stop();
+    if (!Tracer::global().writeChromeJson(tracePath)) {
+        std::cerr << "Could not write trace to " << tracePath << std::endl;
+        return false;
+    }
+    std::cout << "Trace written to " << tracePath << " (" << Tracer::global().events().size() << " events, "
+              << Tracer::global().overwritten() << " overwritten)" << std::endl;
+    return true;
+}
+
+void HarnessOptions::log(std::ostream& out) const
+{
+    out << "Seed: " << seed << " (" << seedSource << "), pinned CPU: ";
+    if (pinCpu < 0) {
+        out << "none";
+    } else {
+        out << pinCpu;
+    }
+    out << ", warmup runs: " << warmupRuns;
+    if (!tracePath.empty()) {
+        out << ", trace: " << tracePath;
+    }
+    out << std::endl;
+}
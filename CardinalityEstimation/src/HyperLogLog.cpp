@@ -0,0 +1,540 @@
+#include "engine/HyperLogLog.h"
+#include "xxhash/xxhash.h"
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+    // 2^-r for every possible register value, so estimating doesn't call pow per register
+    struct InversePowersOfTwo {
+        double values[66];
+        InversePowersOfTwo() {
+            for (int r = 0; r < 66; ++r) {
+                values[r] = std::ldexp(1.0, -r);
+            }
+        }
+        double operator[](int r) const { return values[r]; }
+    };
+    const InversePowersOfTwo kInversePowersOfTwo;
+
+    // Rank of a register at precision p after folding to p - dropped bits. The dropped low index bits become the
+    // leading bits of the rank; only when they are all zero does the old rank carry over.
+    inline uint8_t foldedRank(int idx, uint8_t rank, int dropped)
+    {
+        const uint32_t low = static_cast<uint32_t>(idx) & ((1u << dropped) - 1);
+        if (low == 0) {
+            return static_cast<uint8_t>(dropped + rank);
+        }
+        return static_cast<uint8_t>(dropped - (63 - countLeadingZeros(low)));
+    }
+}
+
+void ValueCounts::remove(uint64_t value)
+{
+    if (numValues == 0) {
+        return;
+    }
+    size_t i = home(value);
+    while (occupied(slots[i]) && slots[i].value != value) {
+        i = (i + 1) & mask;
+    }
+    if (!occupied(slots[i]) || --slots[i].count != 0) {
+        return;
+    }
+    // Backward-shift deletion: move up every later entry of the run whose home slot does not lie in (i, j]
+    for (size_t j = (i + 1) & mask; occupied(slots[j]); j = (j + 1) & mask) {
+        const size_t k = home(slots[j].value);
+        const bool between = i <= j ? (i < k && k <= j) : (i < k || k <= j);
+        if (!between) {
+            slots[i] = slots[j];
+            slots[j].count = 0;
+            i = j;
+        }
+    }
+    numValues--;
+}
+
+void ValueCounts::clear()
+{
+    // Once the epoch wraps, slots tagged 2^32 clears ago would look current again
+    if (++epoch == 0) {
+        for (Slot& slot : slots) {
+            slot.epoch = 0;
+        }
+        epoch = 1;
+    }
+    numValues = 0;
+}
+
+void ValueCounts::release()
+{
+    std::vector<Slot>().swap(slots);
+    mask = 0;
+    numValues = 0;
+}
+
+void ValueCounts::grow()
+{
+    std::vector<Slot> previous(std::max<size_t>(16, slots.size() * 2), Slot{0, 0, 0});
+    previous.swap(slots);
+    mask = slots.size() - 1;
+    numValues = 0;
+    for (const Slot& slot : previous) {
+        if (occupied(slot)) {
+            size_t i = home(slot.value);
+            while (occupied(slots[i])) {
+                i = (i + 1) & mask;
+            }
+            slots[i] = slot;
+            numValues++;
+        }
+    }
+}
+
+uint64_t HyperLogLog::hashValue(uint64_t value)
+{
+    // Use different seeds for different hash functions to reduce collisions
+    uint64_t hash1 = XXHash64(&value, sizeof(value), 0x123456789);
+    uint64_t hash2 = XXHash64(&value, sizeof(value), 0x987654321);
+    return hash1 ^ (hash2 >> 1);  // Combine hashes to reduce collisions
+}
+
+HyperLogLog::HyperLogLog(int bits, HLLRepresentation start, HLLEstimator estimator)
+    : numRegisters(1 << bits), registerBits(bits), initial(start), representation(start), estimator(estimator)
+{
+    enterRepresentation(start);
+}
+
+void HyperLogLog::enterRepresentation(HLLRepresentation target)
+{
+    representation = target;
+    sparse.clear();
+    sparseSorted = 0;
+    // Blocks start clean, so the old bytes can stay where they are
+    if (target == HLLRepresentation::DENSE) {
+        registers.resize(numRegisters);
+    } else if (target == HLLRepresentation::PACKED) {
+        // Two spare bytes let every register be read with one 16-bit window
+        registers.resize(static_cast<size_t>(numRegisters) * 6 / 8 + 2);
+    } else {
+        registers.clear();
+    }
+    touched.assign(registers.empty() ? 0 : (static_cast<size_t>(numRegisters) + kBlockRegisters - 1) >> kBlockShift);
+}
+
+void HyperLogLog::zeroBlock(size_t block)
+{
+    // A packed block of 64 six-bit registers is 48 bytes, so blocks never share a byte
+    const size_t blockBytes = representation == HLLRepresentation::PACKED ? kBlockRegisters * 6 / 8 : kBlockRegisters;
+    const size_t begin = block * blockBytes;
+    std::memset(registers.data() + begin, 0, std::min(blockBytes, registers.size() - begin));
+    touched.mark(block);
+}
+
+void HyperLogLog::releaseStorage()
+{
+    std::vector<uint8_t>().swap(registers);
+    std::vector<uint32_t>().swap(sparse);
+    sparseSorted = 0;
+}
+
+void HyperLogLog::promote()
+{
+    enterRepresentation(registerRepresentation());
+    valueFrequency.forEach([this](uint64_t value, uint64_t) { addHash(hashValue(value)); });
+    // The table is up to 256KB; a long-lived sketch should not keep it once it has registers
+    valueFrequency.release();
+}
+
+void HyperLogLog::setPackedRegister(int idx, uint8_t rank)
+{
+    touchBlock(idx);
+    const size_t bit = static_cast<size_t>(idx) * 6;
+    const unsigned shift = bit & 7;
+    unsigned window = registers[bit >> 3] | (registers[(bit >> 3) + 1] << 8);
+    window = (window & ~(63u << shift)) | (static_cast<unsigned>(rank) << shift);
+    registers[bit >> 3] = static_cast<uint8_t>(window);
+    registers[(bit >> 3) + 1] = static_cast<uint8_t>(window >> 8);
+}
+
+void HyperLogLog::updateRegister(int idx, uint8_t rank)
+{
+    switch (representation) {
+    case HLLRepresentation::EXACT:
+        promote();
+        updateRegister(idx, rank);
+        break;
+    case HLLRepresentation::SPARSE:
+        sparse.push_back((static_cast<uint32_t>(idx) << 6) | rank);
+        // Sort the unsorted tail once it is as long as half the sorted part, so compaction stays amortized O(log n)
+        if (sparse.size() - sparseSorted >= std::max<size_t>(64, sparseSorted / 2)) {
+            compactSparse();
+            // Past this point a pair costs more than the byte a dense register would
+            if (sparse.size() * sizeof(uint32_t) >= static_cast<size_t>(numRegisters)) {
+                convertSparse();
+            }
+        }
+        break;
+    case HLLRepresentation::DENSE:
+        touchBlock(idx);
+        registers[idx] = std::max(registers[idx], rank);
+        break;
+    case HLLRepresentation::PACKED:
+        if (rank > packedRegister(idx)) {
+            setPackedRegister(idx, rank);
+        }
+        break;
+    }
+}
+
+void HyperLogLog::compactSparse()
+{
+    std::sort(sparse.begin() + sparseSorted, sparse.end());
+    std::inplace_merge(sparse.begin(), sparse.begin() + sparseSorted, sparse.end());
+    // Pairs sort by index, then rank; keep the last (highest rank) pair of every index
+    size_t out = 0;
+    for (size_t i = 0; i < sparse.size(); ++i) {
+        if (i + 1 < sparse.size() && (sparse[i + 1] >> 6) == (sparse[i] >> 6)) {
+            continue;
+        }
+        sparse[out++] = sparse[i];
+    }
+    sparse.resize(out);
+    sparseSorted = out;
+}
+
+void HyperLogLog::convertSparse()
+{
+    std::vector<uint32_t> pairs;
+    pairs.swap(sparse);
+    enterRepresentation(HLLRepresentation::DENSE);
+    for (uint32_t pair : pairs) {
+        touchBlock(static_cast<int>(pair >> 6));
+        registers[pair >> 6] = std::max(registers[pair >> 6], static_cast<uint8_t>(pair & 63));
+    }
+}
+
+template <typename Fn>
+void HyperLogLog::forEachRegister(Fn fn) const
+{
+    switch (representation) {
+    case HLLRepresentation::EXACT:
+        break;
+    case HLLRepresentation::SPARSE: {
+        // Unsorted pairs may repeat an index; callers take the maximum, so duplicates are harmless
+        for (uint32_t pair : sparse) {
+            fn(static_cast<int>(pair >> 6), static_cast<uint8_t>(pair & 63));
+        }
+        break;
+    }
+    case HLLRepresentation::DENSE:
+        touched.forEachDirty([this, &fn](size_t block) {
+            const int end = std::min(numRegisters, static_cast<int>(block + 1) << kBlockShift);
+            for (int i = static_cast<int>(block) << kBlockShift; i < end; ++i) {
+                if (registers[i]) {
+                    fn(i, registers[i]);
+                }
+            }
+        });
+        break;
+    case HLLRepresentation::PACKED:
+        touched.forEachDirty([this, &fn](size_t block) {
+            const int end = std::min(numRegisters, static_cast<int>(block + 1) << kBlockShift);
+            for (int i = static_cast<int>(block) << kBlockShift; i < end; ++i) {
+                uint8_t rank = packedRegister(i);
+                if (rank) {
+                    fn(i, rank);
+                }
+            }
+        });
+        break;
+    }
+}
+
+void HyperLogLog::merge(const HyperLogLog& other)
+{
+    if (other.exact()) {
+        other.valueFrequency.forEach([this](uint64_t value, uint64_t) { add(value); });
+        return;
+    }
+    if (exact()) {
+        promote();
+    }
+    if (other.registerBits < registerBits) {
+        downgrade(other.registerBits);
+    }
+    if (other.registerBits > registerBits) {
+        const int dropped = other.registerBits - registerBits;
+        other.forEachRegister([this, dropped](int idx, uint8_t rank) {
+            updateRegister(idx >> dropped, foldedRank(idx, rank, dropped));
+        });
+        return;
+    }
+    if (representation == HLLRepresentation::DENSE && other.representation == HLLRepresentation::DENSE) {
+        // Only the other sketch's dirty blocks can raise a register; a clean block of ours is simply copied
+        other.touched.forEachDirty([this, &other](size_t block) {
+            const size_t begin = block << kBlockShift;
+            const size_t n = std::min<size_t>(kBlockRegisters, numRegisters - begin);
+            if (!touched.dirty(block)) {
+                std::memcpy(registers.data() + begin, other.registers.data() + begin, n);
+                touched.mark(block);
+                return;
+            }
+            for (size_t i = begin; i < begin + n; ++i) {
+                registers[i] = std::max(registers[i], other.registers[i]);
+            }
+        });
+        return;
+    }
+    other.forEachRegister([this](int idx, uint8_t rank) { updateRegister(idx, rank); });
+}
+
+size_t HyperLogLog::compact()
+{
+    const size_t before = memoryUsage();
+    const size_t packedBytes = static_cast<size_t>(numRegisters) * 6 / 8 + 2;
+    if (exact()) {
+        if (before - sizeof(*this) <= packedBytes) {
+            return 0;
+        }
+        promote();
+    }
+    std::vector<uint32_t> pairs;
+    forEachRegister([&pairs](int idx, uint8_t rank) { pairs.push_back((static_cast<uint32_t>(idx) << 6) | rank); });
+    if (representation == HLLRepresentation::SPARSE) {
+        // Unsorted pairs may repeat an index; keep the highest rank of each
+        std::sort(pairs.begin(), pairs.end());
+        size_t out = 0;
+        for (size_t i = 0; i < pairs.size(); ++i) {
+            if (i + 1 < pairs.size() && (pairs[i + 1] >> 6) == (pairs[i] >> 6)) {
+                continue;
+            }
+            pairs[out++] = pairs[i];
+        }
+        pairs.resize(out);
+    }
+    const bool toSparse = pairs.size() * sizeof(uint32_t) < packedBytes;
+    releaseStorage();
+    enterRepresentation(toSparse ? HLLRepresentation::SPARSE : HLLRepresentation::PACKED);
+    if (toSparse) {
+        // forEachRegister walks registers in index order, so the pairs are already sorted
+        pairs.shrink_to_fit();
+        sparse.swap(pairs);
+        sparseSorted = sparse.size();
+    } else {
+        for (uint32_t pair : pairs) {
+            setPackedRegister(static_cast<int>(pair >> 6), static_cast<uint8_t>(pair & 63));
+        }
+    }
+    return before - std::min(before, memoryUsage());
+}
+
+void HyperLogLog::downgrade(int bits)
+{
+    if (bits >= registerBits) {
+        return;
+    }
+    const int dropped = registerBits - bits;
+    std::vector<uint8_t> folded(size_t(1) << bits, 0);
+    forEachRegister([&folded, dropped](int idx, uint8_t rank) {
+        uint8_t& target = folded[idx >> dropped];
+        target = std::max(target, foldedRank(idx, rank, dropped));
+    });
+    registerBits = bits;
+    numRegisters = 1 << bits;
+    if (exact()) {
+        return;  // values are rehashed at the new precision when the exact phase ends
+    }
+    releaseStorage();
+    enterRepresentation(representation);
+    for (int i = 0; i < numRegisters; ++i) {
+        if (folded[i]) {
+            updateRegister(i, folded[i]);
+        }
+    }
+}
+
+void HyperLogLog::registerHistogram(int counts[66]) const
+{
+    std::fill(counts, counts + 66, 0);
+    if (representation == HLLRepresentation::DENSE) {
+        // Four interleaved tallies, so runs of equal registers don't serialize on one counter. Clean blocks are all
+        // zero and are not read.
+        int partial[4][66] = {};
+        int seen = 0;
+        touched.forEachDirty([this, &partial, &seen](size_t block) {
+            const size_t begin = block << kBlockShift;
+            const size_t end = std::min<size_t>(begin + kBlockRegisters, numRegisters);
+            size_t i = begin;
+            for (; i + 4 <= end; i += 4) {
+                partial[0][registers[i]]++;
+                partial[1][registers[i + 1]]++;
+                partial[2][registers[i + 2]]++;
+                partial[3][registers[i + 3]]++;
+            }
+            for (; i < end; ++i) {
+                partial[0][registers[i]]++;
+            }
+            seen += static_cast<int>(end - begin);
+        });
+        for (int r = 0; r < 66; ++r) {
+            counts[r] = partial[0][r] + partial[1][r] + partial[2][r] + partial[3][r];
+        }
+        counts[0] += numRegisters - seen;
+        return;
+    }
+    if (representation == HLLRepresentation::SPARSE) {
+        // Deduplicate a copy so the sketch itself stays untouched; a fully compacted list is used as it is
+        std::vector<uint32_t> copy;
+        if (sparseSorted != sparse.size()) {
+            copy = sparse;
+            std::sort(copy.begin(), copy.end());
+        }
+        const std::vector<uint32_t>& pairs = sparseSorted != sparse.size() ? copy : sparse;
+        int hit = 0;
+        for (size_t i = 0; i < pairs.size(); ++i) {
+            if (i + 1 < pairs.size() && (pairs[i + 1] >> 6) == (pairs[i] >> 6)) {
+                continue;
+            }
+            counts[pairs[i] & 63]++;
+            hit++;
+        }
+        counts[0] = numRegisters - hit;
+        return;
+    }
+    int hit = 0;
+    forEachRegister([counts, &hit](int, uint8_t rank) {
+        counts[rank]++;
+        hit++;
+    });
+    counts[0] = numRegisters - hit;
+}
+
+namespace {
+    // sigma and tau from Ertl's paper, iterated until the floating-point value stops changing
+    double ertlSigma(double x)
+    {
+        if (x == 1.0) {
+            return std::numeric_limits<double>::infinity();
+        }
+        double y = 1;
+        double z = x;
+        double previous;
+        do {
+            x *= x;
+            previous = z;
+            z += x * y;
+            y += y;
+        } while (z != previous);
+        return z;
+    }
+
+    double ertlTau(double x)
+    {
+        if (x == 0.0 || x == 1.0) {
+            return 0;
+        }
+        double y = 1;
+        double z = 1 - x;
+        double previous;
+        do {
+            x = std::sqrt(x);
+            previous = z;
+            y *= 0.5;
+            z -= (1 - x) * (1 - x) * y;
+        } while (z != previous);
+        return z / 3;
+    }
+}
+
+double HyperLogLog::estimate() const
+{
+    // Use exact count if we're still tracking all values
+    if (exact()) {
+        return valueFrequency.size();
+    }
+
+    int counts[66];
+    registerHistogram(counts);
+    return estimateHistogram(counts, registerBits, estimator);
+}
+
+double HyperLogLog::standardError() const
+{
+    return exact() ? 0 : 1.04 / std::sqrt(static_cast<double>(1 << registerBits));
+}
+
+double HyperLogLog::estimateHistogram(const int counts[66], int registerBits, HLLEstimator estimator)
+{
+    const int numRegisters = 1 << registerBits;
+    const double m = numRegisters;
+
+    if (estimator == HLLEstimator::ERTL) {
+        const int q = 64 - registerBits;
+        if (counts[0] == numRegisters) {
+            return 0;
+        }
+        double z = m * ertlTau(1 - counts[q + 1] / m);
+        for (int k = q; k >= 1; --k) {
+            z = 0.5 * (z + counts[k]);
+        }
+        z += m * ertlSigma(counts[0] / m);
+        return m * m / (2 * std::log(2.0) * z);
+    }
+
+    // Standard HyperLogLog estimation
+    double sum = 0;
+    int zeros = counts[0];
+    double harmonicMean = 0;
+
+    for (int r = 0; r < 66; ++r) {
+        if (counts[r]) {
+            double val = kInversePowersOfTwo[r];
+            sum += counts[r] * val;
+            harmonicMean += counts[r] / val;
+        }
+    }
+    
+    // Calculate bias correction factor
+    double alpha;
+    switch (registerBits) {
+        case 4:  alpha = 0.673; break;
+        case 5:  alpha = 0.697; break;
+        case 6:  alpha = 0.709; break;
+        default: alpha = 0.7213 / (1.0 + 1.079 / numRegisters);
+    }
+    
+    double estimate = alpha * m * m / sum;
+    
+    // Enhanced small range correction
+    if (estimate <= 5.0 * numRegisters) {
+        if (zeros > 0) {
+            estimate = numRegisters * std::log(static_cast<double>(numRegisters) / zeros);
+        }
+    }
+    // Large range correction with harmonic mean
+    else if (estimate > (1LL << 32) / 30.0) {
+        double harmonicEstimate = m * m / (harmonicMean / m);
+        estimate = std::min(estimate, harmonicEstimate);
+    }
+    
+    return std::max(1.0, estimate);  // Never return less than 1
+}
+
+size_t HyperLogLog::memoryUsage() const
+{
+    return sizeof(*this) + registers.capacity() + touched.memoryUsage() + sparse.capacity() * sizeof(uint32_t) +
+           valueFrequency.memoryUsage();
+}
+
+void HyperLogLog::reset()
+{
+    valueFrequency.clear();
+    enterRepresentation(initial);
+}
+
+void HyperLogLog::resetRegisters()
+{
+    valueFrequency.clear();
+    enterRepresentation(registerRepresentation());
+}
@@ -0,0 +1,82 @@
+#include "engine/IngestExecutor.h"
+
+IngestExecutor::IngestExecutor(ApplyFn apply, size_t capacity)
+    : apply(std::move(apply)), capacity(capacity == 0 ? 1 : capacity)
+{
+    worker = std::thread(&IngestExecutor::run, this);
+}
+
+IngestExecutor::~IngestExecutor()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    notEmpty.notify_all();
+    worker.join();
+}
+
+std::future<void> IngestExecutor::submit(Batch&& batch)
+{
+    Task task{std::move(batch), std::promise<void>()};
+    std::future<void> done = task.done.get_future();
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        notFull.wait(lock, [this] { return queue.size() < capacity; });
+        queue.push_back(std::move(task));
+        inFlight++;
+    }
+    notEmpty.notify_one();
+    return done;
+}
+
+bool IngestExecutor::trySubmit(Batch& batch, std::future<void>& done)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (queue.size() >= capacity) {
+            return false;
+        }
+        Task task{std::move(batch), std::promise<void>()};
+        done = task.done.get_future();
+        queue.push_back(std::move(task));
+        inFlight++;
+    }
+    notEmpty.notify_one();
+    return true;
+}
+
+void IngestExecutor::drain()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] { return inFlight == 0; });
+}
+
+void IngestExecutor::run()
+{
+    for (;;) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            notEmpty.wait(lock, [this] { return stopping || !queue.empty(); });
+            // Pending batches are still applied on shutdown so no submitted future is left unresolved
+            if (queue.empty()) {
+                return;
+            }
+            task = std::move(queue.front());
+            queue.pop_front();
+        }
+        notFull.notify_one();
+
+        apply(task.batch);
+        task.done.set_value();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            inFlight--;
+            if (inFlight == 0) {
+                idle.notify_all();
+            }
+        }
+    }
+}
@@ -0,0 +1,145 @@
+#include "engine/KMVSketch.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // Scale from a count of sampled hashes to a count of values: 2^64 / theta
+    double inverseRate(uint64_t theta)
+    {
+        return theta == UINT64_MAX ? 1.0 : std::ldexp(1.0, 64) / static_cast<double>(theta);
+    }
+}
+
+KMVSketch::KMVSketch(size_t k)
+    : k(std::max<size_t>(2, k)) {}
+
+void KMVSketch::compact()
+{
+    if (pending.empty()) {
+        return;
+    }
+    const size_t sortedSize = values.size();
+    values.insert(values.end(), pending.begin(), pending.end());
+    pending.clear();
+    std::sort(values.begin() + sortedSize, values.end());
+    std::inplace_merge(values.begin(), values.begin() + sortedSize, values.end());
+    values.erase(std::unique(values.begin(), values.end()), values.end());
+    if (values.size() >= k) {
+        values.resize(k);
+        threshold = values.back();
+    }
+}
+
+const std::vector<uint64_t>& KMVSketch::sorted(std::vector<uint64_t>& scratch) const
+{
+    if (pending.empty()) {
+        return values;
+    }
+    scratch = values;
+    scratch.insert(scratch.end(), pending.begin(), pending.end());
+    std::sort(scratch.begin(), scratch.end());
+    scratch.erase(std::unique(scratch.begin(), scratch.end()), scratch.end());
+    if (scratch.size() > k) {
+        scratch.resize(k);
+    }
+    return scratch;
+}
+
+void KMVSketch::merge(const KMVSketch& other)
+{
+    // The union of two k-samples only holds the k smallest of the union when both are cut at the same k
+    if (other.k < k) {
+        shrink(other.k);
+    }
+    std::vector<uint64_t> scratch;
+    for (uint64_t hash : other.sorted(scratch)) {
+        if (hash >= threshold) {
+            break;
+        }
+        pending.push_back(hash);
+    }
+    compact();
+}
+
+double KMVSketch::estimate() const
+{
+    std::vector<uint64_t> scratch;
+    const std::vector<uint64_t>& hashes = sorted(scratch);
+    if (hashes.size() < k) {
+        return static_cast<double>(hashes.size());
+    }
+    return static_cast<double>(k - 1) * inverseRate(hashes[k - 1]);
+}
+
+KMVSketch::Overlap KMVSketch::overlap(const KMVSketch& left, const KMVSketch& right)
+{
+    std::vector<uint64_t> leftScratch;
+    std::vector<uint64_t> rightScratch;
+    const std::vector<uint64_t>& a = left.sorted(leftScratch);
+    const std::vector<uint64_t>& b = right.sorted(rightScratch);
+    // Below the smaller theta both sketches hold every hash of their set, so the samples can be compared directly
+    const uint64_t theta = std::min(thetaOf(a, left.k), thetaOf(b, right.k));
+    size_t both = 0;
+    size_t onlyA = 0;
+    size_t onlyB = 0;
+    size_t i = 0;
+    size_t j = 0;
+    while (i < a.size() && a[i] < theta && j < b.size() && b[j] < theta) {
+        if (a[i] == b[j]) {
+            both++;
+            i++;
+            j++;
+        } else if (a[i] < b[j]) {
+            onlyA++;
+            i++;
+        } else {
+            onlyB++;
+            j++;
+        }
+    }
+    for (; i < a.size() && a[i] < theta; ++i) {
+        onlyA++;
+    }
+    for (; j < b.size() && b[j] < theta; ++j) {
+        onlyB++;
+    }
+
+    const double scale = inverseRate(theta);
+    Overlap result;
+    result.intersection = both * scale;
+    result.leftOnly = onlyA * scale;
+    result.rightOnly = onlyB * scale;
+    result.unionSize = (both + onlyA + onlyB) * scale;
+    return result;
+}
+
+void KMVSketch::thetaSample(uint64_t& theta, std::vector<uint64_t>& hashes) const
+{
+    std::vector<uint64_t> scratch;
+    const std::vector<uint64_t>& sortedHashes = sorted(scratch);
+    theta = thetaOf(sortedHashes, k);
+    hashes.assign(sortedHashes.begin(), std::lower_bound(sortedHashes.begin(), sortedHashes.end(), theta));
+}
+
+void KMVSketch::shrink(size_t newK)
+{
+    newK = std::max<size_t>(2, newK);
+    if (newK >= k) {
+        return;
+    }
+    compact();
+    k = newK;
+    if (values.size() >= k) {
+        values.resize(k);
+        values.shrink_to_fit();
+        threshold = values.back();
+    }
+    std::vector<uint64_t>().swap(pending);
+}
+
+void KMVSketch::reset()
+{
+    values.clear();
+    pending.clear();
+    threshold = UINT64_MAX;
+}
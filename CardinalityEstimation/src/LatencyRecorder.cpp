@@ -0,0 +1,128 @@
+#include "engine/LatencyRecorder.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+thread_local std::array<LatencyRecorder::CacheEntry, 4> LatencyRecorder::cache;
+thread_local unsigned LatencyRecorder::nextCacheSlot = 0;
+
+namespace {
+    std::atomic<uint64_t> nextRecorderId{1};
+
+    // Nanoseconds per tick, measured once against steady_clock over a few milliseconds
+    double nanosPerTick()
+    {
+        static const double ratio = [] {
+            auto wallStart = std::chrono::steady_clock::now();
+            uint64_t tickStart = LatencyRecorder::now();
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            uint64_t ticks = LatencyRecorder::now() - tickStart;
+            double nanos = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - wallStart).count();
+            return ticks > 0 ? nanos / ticks : 1.0;
+        }();
+        return ratio;
+    }
+
+    // Inclusive tick range of a bucket
+    uint64_t bucketLow(int bucket)
+    {
+        if (bucket < 8) {
+            return static_cast<uint64_t>(bucket);
+        }
+        int e = (bucket - 8) / 8 + 3;
+        return static_cast<uint64_t>(8 + (bucket - 8) % 8) << (e - 3);
+    }
+
+    uint64_t bucketHigh(int bucket)
+    {
+        return bucket + 1 < LatencyRecorder::kBuckets ? bucketLow(bucket + 1) - 1 : UINT64_MAX;
+    }
+}
+
+LatencyRecorder::LatencyRecorder(int numOps, uint32_t sampleInterval)
+    : numOps(numOps), id(nextRecorderId++)
+{
+    sampleInterval = std::min(sampleInterval, uint32_t(1) << 31);
+    sampleMask = sampleInterval > 1 ? (uint32_t(1) << (64 - countLeadingZeros(sampleInterval - 1))) - 1 : 0;
+}
+
+LatencyRecorder::Shard& LatencyRecorder::registerThread()
+{
+    Shard* shard;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        Shard*& owned = threadShards[std::this_thread::get_id()];
+        if (!owned) {
+            shards.emplace_back(new Shard(static_cast<size_t>(numOps) * kBuckets, numOps));
+            owned = shards.back().get();
+        }
+        shard = owned;
+    }
+    CacheEntry& entry = cache[nextCacheSlot++ % cache.size()];
+    entry.recorder = id;
+    entry.shard = shard;
+    return *shard;
+}
+
+LatencyRecorder::Summary LatencyRecorder::summary(int op) const
+{
+    std::vector<uint64_t> merged(kBuckets, 0);
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (const auto& shard : shards) {
+            const std::atomic<uint64_t>* counts = shard->counts.get() + static_cast<size_t>(op) * kBuckets;
+            for (int b = 0; b < kBuckets; ++b) {
+                merged[b] += counts[b].load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    Summary result;
+    for (uint64_t c : merged) {
+        result.count += c;
+    }
+    if (result.count == 0) {
+        return result;
+    }
+    // Report the upper bound of the bucket holding each rank, so percentiles never understate
+    const double scale = nanosPerTick();
+    auto quantile = [&](double q) {
+        uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(q * result.count + 0.5));
+        uint64_t seen = 0;
+        for (int b = 0; b < kBuckets; ++b) {
+            seen += merged[b];
+            if (seen >= rank) {
+                return bucketHigh(b) * scale;
+            }
+        }
+        return bucketHigh(kBuckets - 1) * scale;
+    };
+    result.p50Nanos = quantile(0.5);
+    result.p99Nanos = quantile(0.99);
+    result.p999Nanos = quantile(0.999);
+    result.maxNanos = quantile(1.0);
+    return result;
+}
+
+size_t LatencyRecorder::shardCount() const
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    return shards.size();
+}
+
+size_t LatencyRecorder::memoryUsage() const
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    return shards.size() * (static_cast<size_t>(numOps) * (kBuckets * sizeof(std::atomic<uint64_t>) + sizeof(uint32_t)) +
+                            sizeof(Shard));
+}
+
+void LatencyRecorder::reset()
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (const auto& shard : shards) {
+        for (size_t i = 0; i < static_cast<size_t>(numOps) * kBuckets; ++i) {
+            shard->counts[i].store(0, std::memory_order_relaxed);
+        }
+    }
+}
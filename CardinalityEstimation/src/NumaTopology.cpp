@@ -0,0 +1,83 @@
+#include "engine/NumaTopology.h"
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+    // Parse a sysfs cpu or node list such as "0-15,32-47"
+    std::vector<int> parseCpuList(const std::string& list) {
+        std::vector<int> cpus;
+        std::stringstream ss(list);
+        std::string item;
+        while (std::getline(ss, item, ',')) {
+            if (item.empty()) {
+                continue;
+            }
+            size_t dash = item.find('-');
+            int first = std::stoi(item.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(item.substr(dash + 1));
+            for (int cpu = first; cpu <= last; ++cpu) {
+                cpus.push_back(cpu);
+            }
+        }
+        return cpus;
+    }
+}
+
+NumaTopology NumaTopology::detect()
+{
+    NumaTopology topology;
+#ifdef __linux__
+    // Node ids can have gaps (offlined nodes, some multi-socket boards), so walk the online list rather than count up
+    std::string online;
+    {
+        std::ifstream in("/sys/devices/system/node/online");
+        std::getline(in, online);
+    }
+    for (int node : parseCpuList(online)) {
+        std::ifstream in("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+        if (!in) {
+            continue;
+        }
+        std::string list;
+        std::getline(in, list);
+        std::vector<int> cpus = parseCpuList(list);
+        // Memory-only nodes have no CPUs to pin to
+        if (!cpus.empty()) {
+            topology.nodes.push_back(cpus);
+        }
+    }
+#endif
+    if (topology.nodes.empty()) {
+        std::vector<int> all;
+        int n = static_cast<int>(std::thread::hardware_concurrency());
+        for (int cpu = 0; cpu < (n > 0 ? n : 1); ++cpu) {
+            all.push_back(cpu);
+        }
+        topology.nodes.push_back(all);
+    }
+    return topology;
+}
+
+bool NumaTopology::pinCurrentThread(const std::vector<int>& cpus)
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpus;
+    return false;
+#endif
+}
@@ -0,0 +1,53 @@
+#include "engine/SelectivityModel.h"
+#include <algorithm>
+#include <cmath>
+
+int SelectivityModel::cellOf(const std::vector<CompareExpression>& quals, const double* qualCounts, double liveRows)
+{
+    // Column state: 0 without a qual, else 1 + (op * kSelectivityBuckets + bucket) of its most selective qual
+    int states[kNumColumns] = {0, 0};
+    double best[kNumColumns] = {2, 2};
+    for (size_t i = 0; i < quals.size(); ++i) {
+        const CompareExpression& expr = quals[i];
+        if (expr.columnIdx < 0 || expr.columnIdx >= kNumColumns) {
+            continue;
+        }
+        const double selectivity = liveRows > 0 ? std::max(0.0, qualCounts[i]) / liveRows : 0;
+        if (selectivity >= best[expr.columnIdx]) {
+            continue;
+        }
+        best[expr.columnIdx] = selectivity;
+        int bucket = kSelectivityBuckets - 1;
+        if (selectivity > 0) {
+            bucket = std::min(kSelectivityBuckets - 1, static_cast<int>(-std::log2(std::min(1.0, selectivity))));
+        }
+        const int op = expr.compareOp == EQUAL ? 0 : 1;
+        states[expr.columnIdx] = 1 + op * kSelectivityBuckets + bucket;
+    }
+    return states[0] * kColumnStates + states[1];
+}
+
+double SelectivityModel::correct(int cell, double estimate) const
+{
+    const Cell& c = cells[cell];
+    if (c.weight <= 0) {
+        return estimate;
+    }
+    const double shrunk = c.residual * c.weight / (c.weight + kPriorWeight);
+    return std::max(0.0, (estimate + 1) * std::exp(shrunk) - 1);
+}
+
+void SelectivityModel::train(int cell, double estimate, double trueCount)
+{
+    Cell& c = cells[cell];
+    const double residual = std::log((std::max(0.0, trueCount) + 1) / (std::max(0.0, estimate) + 1));
+    c.weight = std::min(kMaxWeight, c.weight + 1);
+    c.residual += static_cast<float>((residual - c.residual) / c.weight);
+    numSamples++;
+}
+
+void SelectivityModel::reset()
+{
+    cells.fill(Cell());
+    numSamples = 0;
+}
@@ -0,0 +1,147 @@
+#include "engine/SortedSetOps.h"
+#include <algorithm>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CE_SORTED_SET_AVX2
+#include <immintrin.h>
+#endif
+
+namespace {
+    // Shared tail of intersection and difference: values of a from i on, keeping those whose presence in b equals
+    // keepMatches. The first four may already be known to match (bit k of matched), from block compares against
+    // the part of b before j.
+    template <bool keepMatches>
+    size_t finishScalar(const uint64_t* a, size_t i, size_t na, const uint64_t* b, size_t j, size_t nb,
+                        unsigned matched, uint64_t* out, size_t n)
+    {
+        for (size_t k = 0; i < na; ++i, ++k) {
+            bool found = k < 4 && ((matched >> k) & 1);
+            if (!found) {
+                while (j < nb && b[j] < a[i]) {
+                    ++j;
+                }
+                found = j < nb && b[j] == a[i];
+            }
+            if (found == keepMatches) {
+                out[n++] = a[i];
+            }
+        }
+        return n;
+    }
+
+#ifdef CE_SORTED_SET_AVX2
+    // Compare four values of a with four of b in every rotation, then advance whichever block ends first (both on a
+    // tie). Matches of the current a block accumulate in matched until that block is done and emitted.
+    template <bool keepMatches>
+    __attribute__((target("avx2")))
+    size_t blockCompareAvx2(const uint64_t* a, size_t na, const uint64_t* b, size_t nb, uint64_t* out)
+    {
+        size_t i = 0;
+        size_t j = 0;
+        size_t n = 0;
+        unsigned matched = 0;
+        while (i + 4 <= na && j + 4 <= nb) {
+            const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+            __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + j));
+            __m256i eq = _mm256_cmpeq_epi64(va, vb);
+            vb = _mm256_permute4x64_epi64(vb, 0x39);
+            eq = _mm256_or_si256(eq, _mm256_cmpeq_epi64(va, vb));
+            vb = _mm256_permute4x64_epi64(vb, 0x39);
+            eq = _mm256_or_si256(eq, _mm256_cmpeq_epi64(va, vb));
+            vb = _mm256_permute4x64_epi64(vb, 0x39);
+            eq = _mm256_or_si256(eq, _mm256_cmpeq_epi64(va, vb));
+            matched |= static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(eq)));
+
+            const uint64_t aLast = a[i + 3];
+            const uint64_t bLast = b[j + 3];
+            if (aLast <= bLast) {
+                for (int k = 0; k < 4; ++k) {
+                    out[n] = a[i + k];
+                    n += (((matched >> k) & 1) != 0) == keepMatches;
+                }
+                matched = 0;
+                i += 4;
+            }
+            if (bLast <= aLast) {
+                j += 4;
+            }
+        }
+        return finishScalar<keepMatches>(a, i, na, b, j, nb, matched, out, n);
+    }
+#endif
+}
+
+bool sortedSetSimdSupported()
+{
+#ifdef CE_SORTED_SET_AVX2
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+size_t unionSorted(const uint64_t* a, size_t na, const uint64_t* b, size_t nb, uint64_t* out)
+{
+    size_t i = 0;
+    size_t j = 0;
+    size_t n = 0;
+    // Write the smaller head and step past it in either input (both on a tie), without a data-dependent branch
+    while (i < na && j < nb) {
+        const uint64_t x = a[i];
+        const uint64_t y = b[j];
+        out[n++] = std::min(x, y);
+        i += x <= y;
+        j += y <= x;
+    }
+    out = std::copy(a + i, a + na, out + n);
+    std::copy(b + j, b + nb, out);
+    return n + (na - i) + (nb - j);
+}
+
+size_t intersectSorted(const uint64_t* a, size_t na, const uint64_t* b, size_t nb, uint64_t* out, bool allowSimd)
+{
+#ifdef CE_SORTED_SET_AVX2
+    if (allowSimd && sortedSetSimdSupported()) {
+        return blockCompareAvx2<true>(a, na, b, nb, out);
+    }
+#else
+    (void)allowSimd;
+#endif
+    size_t i = 0;
+    size_t j = 0;
+    size_t n = 0;
+    while (i < na && j < nb) {
+        const uint64_t x = a[i];
+        const uint64_t y = b[j];
+        out[n] = x;
+        n += x == y;
+        i += x <= y;
+        j += y <= x;
+    }
+    return n;
+}
+
+size_t differenceSorted(const uint64_t* a, size_t na, const uint64_t* b, size_t nb, uint64_t* out, bool allowSimd)
+{
+#ifdef CE_SORTED_SET_AVX2
+    if (allowSimd && sortedSetSimdSupported()) {
+        return blockCompareAvx2<false>(a, na, b, nb, out);
+    }
+#else
+    (void)allowSimd;
+#endif
+    size_t i = 0;
+    size_t j = 0;
+    size_t n = 0;
+    while (i < na && j < nb) {
+        const uint64_t x = a[i];
+        const uint64_t y = b[j];
+        out[n] = x;
+        n += x < y;
+        i += x <= y;
+        j += y <= x;
+    }
+    std::copy(a + i, a + na, out + n);
+    return n + (na - i);
+}
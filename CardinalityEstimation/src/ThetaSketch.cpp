@@ -0,0 +1,142 @@
+#include "engine/ThetaSketch.h"
+#include "engine/SortedSetOps.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace {
+    // Share of all 64-bit hashes below theta
+    double samplingRate(uint64_t theta)
+    {
+        return theta == UINT64_MAX ? 1.0 : std::ldexp(static_cast<double>(theta), -64);
+    }
+}
+
+ThetaSketch::ThetaSketch(uint64_t theta, std::vector<uint64_t> hashes)
+    : thetaValue(theta), sample(std::move(hashes)) {}
+
+ThetaSketch::ThetaSketch(const KMVSketch& sketch)
+{
+    sketch.thetaSample(thetaValue, sample);
+}
+
+size_t ThetaSketch::countBelow(uint64_t theta) const
+{
+    return static_cast<size_t>(std::lower_bound(sample.begin(), sample.end(), theta) - sample.begin());
+}
+
+double ThetaSketch::estimate() const
+{
+    return static_cast<double>(sample.size()) / samplingRate(thetaValue);
+}
+
+double ThetaSketch::lowerBound(double numStdDevs) const
+{
+    if (exact()) {
+        return static_cast<double>(sample.size());
+    }
+    // The sample count is Binomial(distinct values, p)
+    const double p = samplingRate(thetaValue);
+    const double n = static_cast<double>(sample.size());
+    return std::max(n, estimate() - numStdDevs * std::sqrt(n * (1 - p)) / p);
+}
+
+double ThetaSketch::upperBound(double numStdDevs) const
+{
+    if (exact()) {
+        return static_cast<double>(sample.size());
+    }
+    // An empty sample still leaves room for about 1 / p values
+    const double p = samplingRate(thetaValue);
+    const double n = std::max(1.0, static_cast<double>(sample.size()));
+    return estimate() + numStdDevs * std::sqrt(n * (1 - p)) / p;
+}
+
+ThetaSketch ThetaSketch::unite(const ThetaSketch& a, const ThetaSketch& b, size_t maxSize)
+{
+    uint64_t theta = std::min(a.thetaValue, b.thetaValue);
+    const size_t na = a.countBelow(theta);
+    const size_t nb = b.countBelow(theta);
+    std::vector<uint64_t> hashes(na + nb);
+    hashes.resize(unionSorted(a.sample.data(), na, b.sample.data(), nb, hashes.data()));
+    if (maxSize > 0 && hashes.size() > maxSize) {
+        theta = hashes[maxSize];
+        hashes.resize(maxSize);
+    }
+    return ThetaSketch(theta, std::move(hashes));
+}
+
+ThetaSketch ThetaSketch::intersect(const ThetaSketch& a, const ThetaSketch& b)
+{
+    const uint64_t theta = std::min(a.thetaValue, b.thetaValue);
+    const size_t na = a.countBelow(theta);
+    const size_t nb = b.countBelow(theta);
+    std::vector<uint64_t> hashes(std::min(na, nb));
+    hashes.resize(intersectSorted(a.sample.data(), na, b.sample.data(), nb, hashes.data()));
+    return ThetaSketch(theta, std::move(hashes));
+}
+
+ThetaSketch ThetaSketch::aNotB(const ThetaSketch& a, const ThetaSketch& b)
+{
+    const uint64_t theta = std::min(a.thetaValue, b.thetaValue);
+    const size_t na = a.countBelow(theta);
+    const size_t nb = b.countBelow(theta);
+    std::vector<uint64_t> hashes(na);
+    hashes.resize(differenceSorted(a.sample.data(), na, b.sample.data(), nb, hashes.data()));
+    return ThetaSketch(theta, std::move(hashes));
+}
+
+ThetaSketch ThetaSketch::uniteAll(const std::vector<const ThetaSketch*>& parts, size_t maxSize)
+{
+    if (parts.empty()) {
+        return ThetaSketch();
+    }
+    uint64_t theta = UINT64_MAX;
+    for (const ThetaSketch* part : parts) {
+        theta = std::min(theta, part->thetaValue);
+    }
+    // Union the inputs pairwise, smallest first, so each hash is copied about log(parts) times
+    std::vector<ThetaSketch> pending;
+    pending.reserve(parts.size());
+    for (const ThetaSketch* part : parts) {
+        pending.emplace_back(theta, std::vector<uint64_t>(part->sample.begin(),
+                                                          part->sample.begin() + part->countBelow(theta)));
+    }
+    auto larger = [](const ThetaSketch& x, const ThetaSketch& y) { return x.size() > y.size(); };
+    std::make_heap(pending.begin(), pending.end(), larger);
+    while (pending.size() > 1) {
+        std::pop_heap(pending.begin(), pending.end(), larger);
+        ThetaSketch first = std::move(pending.back());
+        pending.pop_back();
+        std::pop_heap(pending.begin(), pending.end(), larger);
+        pending.back() = unite(first, pending.back(), maxSize);
+        std::push_heap(pending.begin(), pending.end(), larger);
+    }
+    ThetaSketch result = std::move(pending.front());
+    if (maxSize > 0 && result.sample.size() > maxSize) {
+        result.thetaValue = result.sample[maxSize];
+        result.sample.resize(maxSize);
+    }
+    return result;
+}
+
+ThetaSketch ThetaSketch::intersectAll(const std::vector<const ThetaSketch*>& parts)
+{
+    if (parts.empty()) {
+        return ThetaSketch();
+    }
+    // Start from the smallest sample; every intersection can only shrink it further
+    const ThetaSketch* smallest = parts.front();
+    for (const ThetaSketch* part : parts) {
+        if (part->size() < smallest->size()) {
+            smallest = part;
+        }
+    }
+    ThetaSketch result = *smallest;
+    for (const ThetaSketch* part : parts) {
+        if (part != smallest) {
+            result = intersect(result, *part);
+        }
+    }
+    return result;
+}
@@ -0,0 +1,122 @@
+#include "engine/Tracer.h"
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+
+namespace {
+    uint64_t steadyNanos()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    // Event names are string literals from the engine, but escape anyway so the output always parses
+    void writeJsonString(std::ostream& out, const char* text)
+    {
+        out << '"';
+        for (const char* c = text; *c; ++c) {
+            if (*c == '"' || *c == '\\') {
+                out << '\\' << *c;
+            } else if (static_cast<unsigned char>(*c) < 0x20) {
+                out << ' ';
+            } else {
+                out << *c;
+            }
+        }
+        out << '"';
+    }
+}
+
+Tracer& Tracer::global()
+{
+    static Tracer tracer;
+    return tracer;
+}
+
+void Tracer::start(size_t capacity)
+{
+    std::lock_guard<std::mutex> lock(bufferMutex);
+    ring.assign(capacity > 0 ? capacity : 1, Event());
+    written = 0;
+    epochNanos = steadyNanos();
+    active.store(true, std::memory_order_release);
+}
+
+void Tracer::stop()
+{
+    active.store(false, std::memory_order_release);
+}
+
+uint64_t Tracer::now() const
+{
+    return steadyNanos() - epochNanos;
+}
+
+void Tracer::record(const Event& event)
+{
+    std::lock_guard<std::mutex> lock(bufferMutex);
+    if (ring.empty()) {
+        return;
+    }
+    ring[written % ring.size()] = event;
+    written++;
+}
+
+std::vector<Tracer::Event> Tracer::events() const
+{
+    std::lock_guard<std::mutex> lock(bufferMutex);
+    std::vector<Event> result;
+    const uint64_t first = written > ring.size() ? written - ring.size() : 0;
+    result.reserve(static_cast<size_t>(written - first));
+    for (uint64_t i = first; i < written; ++i) {
+        result.push_back(ring[i % ring.size()]);
+    }
+    return result;
+}
+
+uint64_t Tracer::overwritten() const
+{
+    std::lock_guard<std::mutex> lock(bufferMutex);
+    return written > ring.size() ? written - ring.size() : 0;
+}
+
+void Tracer::writeChromeJson(std::ostream& out) const
+{
+    const std::vector<Event> buffered = events();
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    out << std::fixed << std::setprecision(3);
+    for (size_t i = 0; i < buffered.size(); ++i) {
+        const Event& event = buffered[i];
+        out << (i == 0 ? "\n" : ",\n") << "{\"name\":";
+        writeJsonString(out, event.name);
+        out << ",\"cat\":";
+        writeJsonString(out, event.category);
+        out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.threadId
+            << ",\"ts\":" << event.startNanos / 1000.0
+            << ",\"dur\":" << event.durationNanos / 1000.0;
+        if (event.argName) {
+            out << ",\"args\":{";
+            writeJsonString(out, event.argName);
+            out << ":" << event.arg << "}";
+        }
+        out << "}";
+    }
+    out << "\n]}\n";
+}
+
+bool Tracer::writeChromeJson(const std::string& path) const
+{
+    std::ofstream out(path);
+    if (!out) {
+        return false;
+    }
+    writeChromeJson(out);
+    return static_cast<bool>(out);
+}
+
+uint32_t Tracer::currentThreadId()
+{
+    static std::atomic<uint32_t> nextThreadId{1};
+    static thread_local uint32_t threadId = nextThreadId++;
+    return threadId;
+}
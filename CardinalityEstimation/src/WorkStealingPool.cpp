@@ -0,0 +1,140 @@
+#include "engine/WorkStealingPool.h"
+#include "engine/NumaTopology.h"
+
+WorkStealingPool::WorkStealingPool(int numThreads, bool pinToNodes)
+{
+    if (numThreads < 1) {
+        numThreads = 1;
+    }
+    NumaTopology topology = NumaTopology::detect();
+    for (int i = 0; i < numThreads; ++i) {
+        workers.emplace_back(new Worker());
+        if (pinToNodes) {
+            workers[i]->node = i % topology.nodeCount();
+            workers[i]->cpus = topology.cpus(workers[i]->node);
+        }
+    }
+    for (int i = 0; i < numThreads; ++i) {
+        workers[i]->thread = std::thread(&WorkStealingPool::run, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) {
+        worker->thread.join();
+    }
+}
+
+void WorkStealingPool::parallelFor(size_t numTasks, const TaskFn& fn)
+{
+    if (numTasks == 0) {
+        return;
+    }
+    Job job;
+    job.fn = &fn;
+    schedule(job, numTasks, true);
+}
+
+void WorkStealingPool::onEachWorker(const std::function<void(int)>& fn)
+{
+    TaskFn perWorker = [&fn](size_t, int worker) { fn(worker); };
+    Job job;
+    job.fn = &perWorker;
+    schedule(job, workers.size(), false);
+}
+
+void WorkStealingPool::schedule(Job& job, size_t numTasks, bool stealable)
+{
+    job.remaining = numTasks;
+
+    // Counted before the tasks become visible: a worker may take one as soon as it is pushed, and the counter must
+    // not drop below zero. Until the pushes land it only over-counts, which at worst wakes a worker early.
+    if (stealable) {
+        this->stealable.fetch_add(numTasks, std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < numTasks; ++i) {
+        Worker& home = *workers[i % workers.size()];
+        std::lock_guard<std::mutex> lock(home.mutex);
+        home.tasks.push_back(Task{&job, i, stealable});
+        home.queued.fetch_add(1, std::memory_order_relaxed);
+    }
+    {
+        // Passing through sleepMutex orders the counts before the notify, so a worker between checking its wait
+        // predicate and sleeping cannot miss it
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    wake.notify_all();
+
+    std::unique_lock<std::mutex> lock(job.mutex);
+    job.finished.wait(lock, [&job] { return job.remaining == 0; });
+}
+
+bool WorkStealingPool::popLocal(int self, Task& task)
+{
+    Worker& worker = *workers[self];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (worker.tasks.empty()) {
+        return false;
+    }
+    task = worker.tasks.back();
+    worker.tasks.pop_back();
+    worker.queued.fetch_sub(1, std::memory_order_relaxed);
+    if (task.stealable) {
+        stealable.fetch_sub(1, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+bool WorkStealingPool::steal(int self, Task& task)
+{
+    const int n = size();
+    for (int i = 1; i < n; ++i) {
+        Worker& victim = *workers[(self + i) % n];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        // Oldest stealable task; pinned tasks stay for their worker
+        for (auto it = victim.tasks.begin(); it != victim.tasks.end(); ++it) {
+            if (it->stealable) {
+                task = *it;
+                victim.tasks.erase(it);
+                victim.queued.fetch_sub(1, std::memory_order_relaxed);
+                stealable.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::run(int self)
+{
+    if (!workers[self]->cpus.empty()) {
+        NumaTopology::pinCurrentThread(workers[self]->cpus);
+    }
+    for (;;) {
+        Task task;
+        if (popLocal(self, task) || steal(self, task)) {
+            (*task.job->fn)(task.index, self);
+            // Decrement under the job lock: the caller owns the job and may destroy it as soon as it sees zero
+            std::lock_guard<std::mutex> lock(task.job->mutex);
+            if (--task.job->remaining == 0) {
+                task.job->finished.notify_one();
+            }
+            continue;
+        }
+        const Worker& worker = *workers[self];
+        auto hasWork = [this, &worker] {
+            return worker.queued.load(std::memory_order_relaxed) > 0 || stealable.load(std::memory_order_relaxed) > 0;
+        };
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wake.wait(lock, [this, &hasWork] { return stopping || hasWork(); });
+        if (stopping && !hasWork()) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,159 @@
+#include "engine/HyperLogLog.h"
+#include "executer/DataGenerator.h"
+#include "harness/HarnessOptions.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Accuracy versus cost of every HyperLogLog configuration: precision x representation x estimator, over the
+// distributions the test suite uses. Each workload is regenerated for every seed; errors are |estimate - truth| /
+// truth against the exact distinct count, and costs are averaged over seeds.
+
+namespace {
+    HarnessOptions options(1, 1);
+
+    struct Workload {
+        const char* name;
+        DataSpec spec;
+        size_t tuples;
+    };
+
+    struct Cell {
+        std::vector<double> errors[2];  // per estimator
+        double insertNanos = 0;         // summed over seeds
+        double estimateNanos[2] = {0, 0};
+        double bytes = 0;
+    };
+
+    const HLLRepresentation kRepresentations[] = {HLLRepresentation::EXACT, HLLRepresentation::SPARSE,
+                                                  HLLRepresentation::DENSE, HLLRepresentation::PACKED};
+    const char* const kRepresentationNames[] = {"exact", "sparse", "dense", "packed"};
+    const HLLEstimator kEstimators[] = {HLLEstimator::CLASSIC, HLLEstimator::ERTL};
+    const char* const kEstimatorNames[] = {"classic", "ertl"};
+    const int kPrecisions[] = {10, 12, 14, 16};
+    const int kEstimateRepeats = 16;
+
+    inline uint64_t packTuple(const std::tuple<int, int>& tuple) {
+        return (static_cast<uint64_t>(std::get<0>(tuple)) << 32) | static_cast<uint32_t>(std::get<1>(tuple));
+    }
+
+    double percentile(std::vector<double> values, double q) {
+        std::sort(values.begin(), values.end());
+        size_t rank = static_cast<size_t>(std::ceil(q * values.size()));
+        return values[std::min(values.size() - 1, rank > 0 ? rank - 1 : 0)];
+    }
+
+    std::vector<Workload> makeWorkloads() {
+        std::vector<Workload> workloads;
+        DataSpec uniform;
+        workloads.push_back({"uniform-1K", uniform, 1000});
+        workloads.push_back({"uniform-100K", uniform, 100000});
+        workloads.push_back({"uniform-1M", uniform, 1000000});
+        DataSpec zipf;
+        zipf.distribution = Distribution::ZIPF;
+        zipf.maxValue = 100000;
+        zipf.zipfS = 1.1;
+        workloads.push_back({"zipf-1M", zipf, 1000000});
+        DataSpec duplicates;
+        duplicates.distribution = Distribution::DUPLICATES;
+        duplicates.distinctTuples = 5000;
+        workloads.push_back({"duplicates-1M", duplicates, 1000000});
+        return workloads;
+    }
+
+    void runWorkload(const Workload& workload, int seeds) {
+        const size_t numConfigs = sizeof(kPrecisions) / sizeof(kPrecisions[0]) * 4;
+        std::vector<Cell> cells(numConfigs);
+
+        for (int run = 0; run < seeds; ++run) {
+            std::vector<uint64_t> keys;
+            keys.reserve(workload.tuples);
+            for (const auto& tuple : DataGenerator(workload.spec, options.seed + run).generate(workload.tuples)) {
+                keys.push_back(packTuple(tuple));
+            }
+            std::vector<uint64_t> sorted(keys);
+            std::sort(sorted.begin(), sorted.end());
+            const double truth = static_cast<double>(std::unique(sorted.begin(), sorted.end()) - sorted.begin());
+
+            for (size_t c = 0; c < numConfigs; ++c) {
+                for (int w = 0; w < options.warmupRuns; ++w) {
+                    HyperLogLog warmup(kPrecisions[c / 4], kRepresentations[c % 4]);
+                    for (uint64_t key : keys) {
+                        warmup.add(key);
+                    }
+                }
+                HyperLogLog sketch(kPrecisions[c / 4], kRepresentations[c % 4]);
+                auto start = std::chrono::steady_clock::now();
+                for (uint64_t key : keys) {
+                    sketch.add(key);
+                }
+                auto end = std::chrono::steady_clock::now();
+                Cell& cell = cells[c];
+                cell.insertNanos += std::chrono::duration<double, std::nano>(end - start).count() / keys.size();
+                cell.bytes += sketch.memoryUsage();
+
+                for (int e = 0; e < 2; ++e) {
+                    sketch.setEstimator(kEstimators[e]);
+                    volatile double estimate = 0;
+                    auto estimateStart = std::chrono::steady_clock::now();
+                    for (int r = 0; r < kEstimateRepeats; ++r) {
+                        estimate = sketch.estimate();
+                    }
+                    auto estimateEnd = std::chrono::steady_clock::now();
+                    cell.estimateNanos[e] +=
+                        std::chrono::duration<double, std::nano>(estimateEnd - estimateStart).count() / kEstimateRepeats;
+                    cell.errors[e].push_back(std::abs(estimate - truth) / truth * 100);
+                }
+            }
+        }
+
+        for (size_t c = 0; c < numConfigs; ++c) {
+            const Cell& cell = cells[c];
+            for (int e = 0; e < 2; ++e) {
+                std::cout << std::fixed << std::setprecision(3)
+                          << std::setw(15) << workload.name
+                          << std::setw(4) << kPrecisions[c / 4]
+                          << std::setw(8) << kRepresentationNames[c % 4]
+                          << std::setw(9) << kEstimatorNames[e]
+                          << std::setw(10) << percentile(cell.errors[e], 0.5)
+                          << std::setw(10) << percentile(cell.errors[e], 0.9)
+                          << std::setw(10) << percentile(cell.errors[e], 0.99)
+                          << std::setprecision(1)
+                          << std::setw(11) << cell.insertNanos / seeds
+                          << std::setw(13) << cell.estimateNanos[e] / seeds
+                          << std::setw(10) << static_cast<size_t>(cell.bytes / seeds) << std::endl;
+            }
+        }
+    }
+}
+
+// Usage: accuracy [--seed N] [--pin CPU] [--warmup N] [seeds] [workload-name-filter]. Runs use seeds N, N + 1, ...
+int main(int argc, char** argv) {
+    if (!options.parse(argc, argv)) {
+        return 1;
+    }
+    if (!options.pinCurrentThread()) {
+        std::cerr << "Could not pin to CPU " << options.pinCpu << std::endl;
+    }
+    options.log(std::cout);
+    const std::vector<std::string>& args = options.positional;
+    const int seeds = args.size() > 0 ? std::max(1, std::atoi(args[0].c_str())) : 10;
+    const std::string filter = args.size() > 1 ? args[1] : "";
+
+    std::cout << "=== HyperLogLog Accuracy vs Cost (" << seeds << " seeds, |error| percentiles in %) ===" << std::endl;
+    std::cout << std::setw(15) << "Workload" << std::setw(4) << "p" << std::setw(8) << "Repr"
+              << std::setw(9) << "Estim" << std::setw(10) << "p50%" << std::setw(10) << "p90%"
+              << std::setw(10) << "p99%" << std::setw(11) << "ns/insert" << std::setw(13) << "ns/estimate"
+              << std::setw(10) << "bytes" << std::endl;
+    for (const Workload& workload : makeWorkloads()) {
+        if (filter.empty() || std::string(workload.name).find(filter) != std::string::npos) {
+            runWorkload(workload, seeds);
+        }
+    }
+    return 0;
+}
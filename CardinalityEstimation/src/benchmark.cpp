@@ -0,0 +1,519 @@
+#include "CardinalityEstimation.h"
+#include "engine/GroupedDistinct.h"
+#include "engine/HyperLogLog.h"
+#include "engine/KMVSketch.h"
+#include "engine/LatencyRecorder.h"
+#include "engine/NumaTopology.h"
+#include "engine/SortedSetOps.h"
+#include "engine/ThetaSketch.h"
+#include "executer/DataExecuterDemo.h"
+#include "executer/DataGenerator.h"
+#include "harness/HarnessOptions.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <thread>
+#include <vector>
+
+// Heap allocations made by the process, for the allocation-traffic columns
+static std::atomic<uint64_t> allocationCount{0};
+
+void* operator new(std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+    HarnessOptions options(12345, 1);
+
+    // Pre-generated input so the timed region measures the engine only
+    std::vector<std::tuple<int, int>> makeTuples(size_t n, int valueRange) {
+        DataSpec spec;
+        spec.maxValue = valueRange;
+        return DataGenerator(spec, options.seed).generate(n);
+    }
+
+    std::vector<std::vector<std::tuple<int, int>>> makeBatches(const std::vector<std::tuple<int, int>>& tuples,
+                                                               size_t batchSize) {
+        std::vector<std::vector<std::tuple<int, int>>> batches;
+        for (size_t i = 0; i < tuples.size(); i += batchSize) {
+            size_t end = std::min(tuples.size(), i + batchSize);
+            batches.emplace_back(tuples.begin() + i, tuples.begin() + end);
+        }
+        return batches;
+    }
+
+    // Returns tuples/s for inserting every batch; estimateMicros receives the latency of one estimate() afterwards
+    double runInsertBatches(const CEConfig& config, const std::vector<std::vector<std::tuple<int, int>>>& batches,
+                            double* estimateMicros = nullptr) {
+        for (int w = 0; w < options.warmupRuns; ++w) {
+            CEEngine warmup(config);
+            for (const auto& batch : batches) {
+                warmup.insertTuples(batch);
+            }
+        }
+        CEEngine engine(config);
+        size_t total = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        for (const auto& batch : batches) {
+            engine.insertTuples(batch);
+            total += batch.size();
+        }
+        auto end = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(end - start).count();
+
+        if (estimateMicros) {
+            auto estimateStart = std::chrono::steady_clock::now();
+            volatile double estimate = engine.estimate();
+            (void)estimate;
+            auto estimateEnd = std::chrono::steady_clock::now();
+            *estimateMicros = std::chrono::duration<double, std::micro>(estimateEnd - estimateStart).count();
+        }
+        return total / seconds;
+    }
+}
+
+// Batch insert throughput as the worker count grows
+void benchThreadScaling() {
+    const size_t NUM_TUPLES = 20000000;
+    const size_t BATCH_SIZE = 1 << 18;
+    auto batches = makeBatches(makeTuples(NUM_TUPLES, 1 << 30), BATCH_SIZE);
+
+    std::cout << "\n=== Thread Scaling (insertTuples, batch " << BATCH_SIZE << ") ===" << std::endl;
+    std::cout << "Hardware threads: " << std::thread::hardware_concurrency() << std::endl;
+    std::cout << std::setw(10) << "Threads" << std::setw(18) << "Mtuples/s" << std::setw(12) << "Speedup" << std::endl;
+
+    double baseline = 0;
+    for (int threads : {1, 2, 4, 8, 16, 32}) {
+        CEConfig config;
+        config.numThreads = threads;
+        double rate = runInsertBatches(config, batches);
+        if (threads == 1) {
+            baseline = rate;
+        }
+        std::cout << std::fixed << std::setprecision(2)
+                  << std::setw(10) << threads
+                  << std::setw(18) << rate / 1e6
+                  << std::setw(12) << rate / baseline << std::endl;
+    }
+}
+
+// Shared sketch (partials allocated by the caller, merged every batch, workers float across sockets) versus
+// node-local shards (pinned workers, first-touch allocation, merged at estimate time)
+void benchNumaPlacement() {
+    const size_t NUM_TUPLES = 20000000;
+    const size_t BATCH_SIZE = 1 << 18;
+    auto batches = makeBatches(makeTuples(NUM_TUPLES, 1 << 30), BATCH_SIZE);
+    NumaTopology topology = NumaTopology::detect();
+    int threads = std::max(2, static_cast<int>(std::thread::hardware_concurrency()));
+
+    std::cout << "\n=== NUMA Placement (" << threads << " threads, " << topology.nodeCount() << " node(s)) ===" << std::endl;
+    std::cout << std::setw(22) << "Placement" << std::setw(18) << "Mtuples/s" << std::setw(18) << "Estimate(us)" << std::endl;
+
+    for (bool sharded : {false, true}) {
+        CEConfig config;
+        config.numThreads = threads;
+        config.numaSharding = sharded;
+        double estimateMicros = 0;
+        double rate = runInsertBatches(config, batches, &estimateMicros);
+        std::cout << std::fixed << std::setprecision(2)
+                  << std::setw(22) << (sharded ? "node-local shards" : "shared/cross-socket")
+                  << std::setw(18) << rate / 1e6
+                  << std::setw(18) << estimateMicros << std::endl;
+    }
+}
+
+// Generator throughput per distribution, so generated inputs never dominate a benchmark
+void benchGenerators() {
+    const size_t NUM_TUPLES = 50000000;
+    const size_t BATCH_SIZE = 1 << 16;
+    std::vector<std::tuple<int, int>> batch(BATCH_SIZE);
+
+    std::cout << "\n=== Data Generators (batches of " << BATCH_SIZE << ") ===" << std::endl;
+    std::cout << std::setw(14) << "Distribution" << std::setw(18) << "Mtuples/s" << std::endl;
+
+    const std::pair<const char*, Distribution> distributions[] = {
+        {"uniform", Distribution::UNIFORM}, {"zipf", Distribution::ZIPF},
+        {"correlated", Distribution::CORRELATED}, {"sequential", Distribution::SEQUENTIAL},
+        {"constant", Distribution::CONSTANT}, {"duplicates", Distribution::DUPLICATES}};
+    for (const auto& entry : distributions) {
+        DataSpec spec;
+        spec.distribution = entry.second;
+        spec.maxValue = 1 << 20;
+        DataGenerator generator(spec, options.seed);
+        volatile int sink = 0;
+        for (int w = 0; w < options.warmupRuns; ++w) {
+            generator.fill(batch.data(), BATCH_SIZE);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t done = 0; done < NUM_TUPLES; done += BATCH_SIZE) {
+            generator.fill(batch.data(), BATCH_SIZE);
+            sink = sink + std::get<0>(batch[BATCH_SIZE - 1]);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << std::fixed << std::setprecision(2)
+                  << std::setw(14) << entry.first
+                  << std::setw(18) << NUM_TUPLES / seconds / 1e6 << std::endl;
+    }
+}
+
+// Rows/s of the demo executer's exact scan as scan threads grow. Uniform data puts every value range in every zone,
+// so zone maps prune nothing and each query reads every row.
+void benchOracleScan() {
+    const int NUM_ROWS = 10000000;
+    const int NUM_QUERIES = 20;
+    DataExecuterDemo executer(NUM_ROWS - 1, 0, DataSpec(), options.seed);
+    DataGenerator constants(DataSpec(), options.seed + 1);
+
+    std::cout << "\n=== Oracle Scan (" << NUM_ROWS << " rows, GREATER + EQUAL quals) ===" << std::endl;
+    std::cout << std::setw(10) << "Threads" << std::setw(18) << "Mrows/s" << std::setw(12) << "Speedup" << std::endl;
+
+    double baseline = 0;
+    for (int threads : {1, 2, 4, 8, 16}) {
+        executer.setScanThreads(threads);
+        volatile int sink = 0;
+        for (int w = 0; w < options.warmupRuns; ++w) {
+            sink = sink + executer.countMatches({{0, GREATER, 0}});
+        }
+        auto start = std::chrono::steady_clock::now();
+        for (int q = 0; q < NUM_QUERIES; ++q) {
+            std::vector<CompareExpression> quals = {
+                {0, GREATER, static_cast<int>(constants.uniform(INT_MAX))},
+                {1, EQUAL, static_cast<int>(constants.uniform(INT_MAX))}};
+            sink = sink + executer.countMatches(quals);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double rate = static_cast<double>(NUM_ROWS) * NUM_QUERIES / seconds;
+        if (threads == 1) {
+            baseline = rate;
+        }
+        std::cout << std::fixed << std::setprecision(2)
+                  << std::setw(10) << threads
+                  << std::setw(18) << rate / 1e6
+                  << std::setw(12) << rate / baseline << std::endl;
+    }
+}
+
+// Short-lived engines, one per small intermediate result: constructing a fresh engine each time versus recycling
+// engines through a CEEnginePool
+void benchEngineRecycling() {
+    const int NUM_CYCLES = 20000;
+    const size_t TUPLES_PER_CYCLE = 1000;
+    const std::vector<std::tuple<int, int>> batch = makeTuples(TUPLES_PER_CYCLE, INT_MAX);
+
+    std::cout << "\n=== Engine Recycling (" << NUM_CYCLES << " engines x " << TUPLES_PER_CYCLE
+              << " tuples) ===" << std::endl;
+    std::cout << std::setw(12) << "Mode" << std::setw(14) << "us/engine" << std::setw(16) << "allocs/engine"
+              << std::endl;
+
+    CEEnginePool pool;
+    volatile double sink = 0;
+    for (bool pooled : {false, true}) {
+        for (int w = 0; w < std::max(1, options.warmupRuns); ++w) {
+            std::unique_ptr<CEEngine> engine = pooled ? pool.acquire() : std::unique_ptr<CEEngine>(new CEEngine());
+            engine->insertTuples(batch);
+            if (pooled) {
+                pool.release(std::move(engine));
+            }
+        }
+        const uint64_t allocationsBefore = allocationCount.load();
+        auto start = std::chrono::steady_clock::now();
+        for (int cycle = 0; cycle < NUM_CYCLES; ++cycle) {
+            std::unique_ptr<CEEngine> engine = pooled ? pool.acquire() : std::unique_ptr<CEEngine>(new CEEngine());
+            engine->insertTuples(batch);
+            sink = sink + engine->estimate();
+            if (pooled) {
+                pool.release(std::move(engine));
+            }
+        }
+        double micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        std::cout << std::fixed << std::setprecision(2)
+                  << std::setw(12) << (pooled ? "pooled" : "new/delete")
+                  << std::setw(14) << micros / NUM_CYCLES
+                  << std::setw(16) << static_cast<double>(allocationCount.load() - allocationsBefore) / NUM_CYCLES
+                  << std::endl;
+    }
+}
+
+// |A ∩ B| and |A \ B| for two sets of a million values at several overlaps: k-minimum-values samples compared
+// directly versus inclusion-exclusion on HyperLogLog, both at 16KB per set
+void benchSetOverlap() {
+    const uint64_t SET_SIZE = 1000000;
+    const int TRIALS = 5;
+    const int ESTIMATES = 200;
+    std::cout << "\n=== Set Overlap (2 x " << SET_SIZE << " values, 16KB sketches, " << TRIALS << " trials) ==="
+              << std::endl;
+    std::cout << std::setw(10) << "Overlap" << std::setw(22) << "Method" << std::setw(16) << "A&B error %"
+              << std::setw(16) << "A-B error %" << std::setw(16) << "us/estimate" << std::endl;
+
+    for (double fraction : {0.5, 0.1, 0.01}) {
+        const uint64_t shared = static_cast<uint64_t>(SET_SIZE * fraction);
+        double kmvErrors[2] = {0, 0};
+        double hllErrors[2] = {0, 0};
+        double kmvMicros = 0;
+        double hllMicros = 0;
+        for (int trial = 0; trial < TRIALS; ++trial) {
+            // A holds keys [0, n), B holds [n - shared, 2n - shared); the trial picks a disjoint key range
+            const uint64_t base = (options.seed + static_cast<uint64_t>(trial)) << 32;
+            KMVSketch kmvA(2048), kmvB(2048);
+            HyperLogLog hllA(14, HLLRepresentation::DENSE), hllB(14, HLLRepresentation::DENSE);
+            for (uint64_t i = 0; i < SET_SIZE; ++i) {
+                const uint64_t a = HyperLogLog::hashValue(base + i);
+                const uint64_t b = HyperLogLog::hashValue(base + SET_SIZE - shared + i);
+                kmvA.addHash(a);
+                hllA.addHash(a);
+                kmvB.addHash(b);
+                hllB.addHash(b);
+            }
+            kmvA.compact();
+            kmvB.compact();
+
+            KMVSketch::Overlap overlap;
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < ESTIMATES; ++i) {
+                overlap = KMVSketch::overlap(kmvA, kmvB);
+            }
+            kmvMicros += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+            double intersection = 0;
+            double difference = 0;
+            start = std::chrono::steady_clock::now();
+            for (int i = 0; i < ESTIMATES; ++i) {
+                HyperLogLog merged = hllA;
+                merged.merge(hllB);
+                const double unionSize = merged.estimate();
+                intersection = hllA.estimate() + hllB.estimate() - unionSize;
+                difference = unionSize - hllB.estimate();
+            }
+            hllMicros += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+            const double trueDifference = static_cast<double>(SET_SIZE - shared);
+            kmvErrors[0] += std::abs(overlap.intersection - shared) / shared * 100;
+            kmvErrors[1] += std::abs(overlap.leftOnly - trueDifference) / trueDifference * 100;
+            hllErrors[0] += std::abs(intersection - shared) / shared * 100;
+            hllErrors[1] += std::abs(difference - trueDifference) / trueDifference * 100;
+        }
+        auto row = [&](const char* method, const double* errors, double micros) {
+            std::cout << std::fixed << std::setprecision(2)
+                      << std::setw(9) << fraction * 100 << "%"
+                      << std::setw(22) << method
+                      << std::setw(16) << errors[0] / TRIALS
+                      << std::setw(16) << errors[1] / TRIALS
+                      << std::setw(16) << micros / TRIALS / ESTIMATES << std::endl;
+        };
+        row("KMV (k=2048)", kmvErrors, kmvMicros);
+        row("HLL incl-excl (p=14)", hllErrors, hllMicros);
+    }
+}
+
+// Sorted-set kernels behind ThetaSketch on two sorted arrays of random hashes sharing half their values, scalar versus
+// AVX2, and the theta set operations on engine-sized (2048 hash) sketches
+void benchSortedSetOps() {
+    const size_t SIZE = 1 << 20;
+    const int REPEATS = 20;
+    std::cout << "\n=== Sorted Set Kernels (2 x " << SIZE << " hashes, 50% shared) ===" << std::endl;
+
+    DataGenerator generator(DataSpec(), options.seed);
+    std::vector<uint64_t> a(SIZE);
+    std::vector<uint64_t> b(SIZE);
+    for (size_t i = 0; i < SIZE; ++i) {
+        a[i] = generator.uniform(UINT32_MAX) * (uint64_t(1) << 32) + generator.uniform(UINT32_MAX);
+        b[i] = i % 2 ? a[i] : generator.uniform(UINT32_MAX) * (uint64_t(1) << 32) + generator.uniform(UINT32_MAX);
+    }
+    for (auto* values : {&a, &b}) {
+        std::sort(values->begin(), values->end());
+        values->erase(std::unique(values->begin(), values->end()), values->end());
+    }
+    std::vector<uint64_t> out(a.size() + b.size());
+
+    auto time = [&](auto&& kernel) {
+        volatile size_t sink = kernel();
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < REPEATS; ++r) {
+            sink = sink + kernel();
+        }
+        double nanos = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        return nanos / REPEATS / (a.size() + b.size());
+    };
+    std::cout << std::setw(14) << "Operation" << std::setw(16) << "scalar ns/in" << std::setw(16) << "AVX2 ns/in"
+              << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << std::setw(14) << "union"
+              << std::setw(16) << time([&] { return unionSorted(a.data(), a.size(), b.data(), b.size(), out.data()); })
+              << std::setw(16) << "-" << std::endl;
+    for (bool intersect : {true, false}) {
+        auto kernel = [&](bool simd) {
+            return [&, simd] {
+                return intersect ? intersectSorted(a.data(), a.size(), b.data(), b.size(), out.data(), simd)
+                                 : differenceSorted(a.data(), a.size(), b.data(), b.size(), out.data(), simd);
+            };
+        };
+        std::cout << std::setw(14) << (intersect ? "intersect" : "a-not-b")
+                  << std::setw(16) << time(kernel(false));
+        if (sortedSetSimdSupported()) {
+            std::cout << std::setw(16) << time(kernel(true)) << std::endl;
+        } else {
+            std::cout << std::setw(16) << "n/a" << std::endl;
+        }
+    }
+
+    // Engine-sized sketches: 2048 hashes each, cut from the arrays above
+    KMVSketch left(2048);
+    KMVSketch right(2048);
+    left.addHashes(a.data(), a.size());
+    right.addHashes(b.data(), b.size());
+    const ThetaSketch x(left);
+    const ThetaSketch y(right);
+    const int OPS = 10000;
+    auto opMicros = [&](auto&& op) {
+        volatile double sink = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < OPS; ++i) {
+            sink = sink + op().estimate();
+        }
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / OPS;
+    };
+    std::cout << std::setprecision(2) << "Theta ops on 2048-hash sketches (us): union "
+              << opMicros([&] { return ThetaSketch::unite(x, y, 2048); })
+              << ", intersect " << opMicros([&] { return ThetaSketch::intersect(x, y); })
+              << ", a-not-b " << opMicros([&] { return ThetaSketch::aNotB(x, y); }) << std::endl;
+}
+
+// Group-by distinct counting through GroupedDistinct::addBatch as the number of groups grows: batch throughput and
+// memory per distinct (group, value) pair, against what one dense p=14 HyperLogLog per group would need
+void benchGroupedDistinct() {
+    const size_t NUM_TUPLES = 4000000;
+    const size_t BATCH = 4096;
+    std::cout << "\n=== Grouped Distinct (" << NUM_TUPLES << " tuples, p=14) ===" << std::endl;
+    std::cout << std::setw(10) << "Groups" << std::setw(14) << "ns/tuple" << std::setw(14) << "dense groups"
+              << std::setw(16) << "bytes/pair" << std::setw(12) << "MB" << std::setw(16) << "dense-only MB"
+              << std::endl;
+
+    for (uint32_t groups : {100u, 10000u, 1000000u}) {
+        DataGenerator generator(DataSpec(), options.seed);
+        std::vector<std::tuple<int, int>> tuples(NUM_TUPLES);
+        for (auto& tuple : tuples) {
+            tuple = std::make_tuple(static_cast<int>(generator.uniform(groups)),
+                                    static_cast<int>(generator.uniform(NUM_TUPLES)));
+        }
+        std::vector<std::tuple<int, int>> sorted(tuples);
+        std::sort(sorted.begin(), sorted.end());
+        const double distinctPairs = static_cast<double>(std::unique(sorted.begin(), sorted.end()) - sorted.begin());
+
+        GroupedDistinct grouped;
+        std::vector<std::tuple<int, int>> batch;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < NUM_TUPLES; i += BATCH) {
+            batch.assign(tuples.begin() + i, tuples.begin() + std::min(NUM_TUPLES, i + BATCH));
+            grouped.addBatch(batch);
+        }
+        double nanos = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        std::cout << std::fixed << std::setprecision(2)
+                  << std::setw(10) << groups
+                  << std::setw(14) << nanos / NUM_TUPLES
+                  << std::setw(14) << grouped.numDense()
+                  << std::setw(16) << grouped.memoryUsage() / distinctPairs
+                  << std::setw(12) << grouped.memoryUsage() / 1048576.0
+                  << std::setw(16) << grouped.numGroups() * 16384.0 / 1048576.0 << std::endl;
+    }
+}
+
+// Cost of timing one call, and the engine's per-call latency percentiles when built with CE_LATENCY_STATS
+void benchLatency() {
+    const int NUM_CALLS = 10000000;
+    std::cout << "\n=== Call Latency ===" << std::endl;
+
+    volatile uint64_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < NUM_CALLS; ++i) {
+        sink = sink + i;
+    }
+    const double bare = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    for (uint32_t interval : {1u, 4u, 16u, 64u}) {
+        LatencyRecorder recorder(1, interval);
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < NUM_CALLS; ++i) {
+            LatencyScope scope(recorder, 0);
+            sink = sink + i;
+        }
+        double timed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        std::cout << std::fixed << std::setprecision(2) << "Recording overhead, 1 in " << std::setw(2) << interval
+                  << " calls timed: " << (timed - bare) / NUM_CALLS << " ns/call" << std::endl;
+    }
+
+    const std::vector<std::tuple<int, int>> tuples = makeTuples(1000000, INT_MAX);
+    DataGenerator constants(DataSpec(), options.seed + 1);
+    CEEngine engine;
+    for (const auto& tuple : tuples) {
+        engine.insertTuple(tuple);
+    }
+    engine.publish();
+    for (int i = 0; i < 10000; ++i) {
+        engine.estimateFrequency(0, static_cast<int>(constants.uniform(INT_MAX)));
+        engine.query({{0, GREATER, static_cast<int>(constants.uniform(INT_MAX))}});
+        if (i % 10 == 0) {
+            engine.estimate();
+            engine.estimateJoin(0, engine, 1);
+        }
+    }
+
+    const std::pair<const char*, CEOperation> operations[] = {
+        {"insertTuple", CEOperation::INSERT_TUPLE}, {"estimate", CEOperation::ESTIMATE},
+        {"estimateFrequency", CEOperation::ESTIMATE_FREQUENCY}, {"query", CEOperation::QUERY},
+        {"estimateJoin", CEOperation::ESTIMATE_JOIN}};
+    if (engine.latency(CEOperation::INSERT_TUPLE).count == 0) {
+        std::cout << "Engine percentiles: build with -DCE_LATENCY_STATS=ON" << std::endl;
+        return;
+    }
+    std::cout << std::setw(20) << "Operation" << std::setw(10) << "Calls" << std::setw(12) << "p50 ns"
+              << std::setw(12) << "p99 ns" << std::setw(12) << "p999 ns" << std::setw(12) << "max ns" << std::endl;
+    for (const auto& entry : operations) {
+        CELatency latency = engine.latency(entry.second);
+        std::cout << std::fixed << std::setprecision(0)
+                  << std::setw(20) << entry.first
+                  << std::setw(10) << latency.count
+                  << std::setw(12) << latency.p50Nanos
+                  << std::setw(12) << latency.p99Nanos
+                  << std::setw(12) << latency.p999Nanos
+                  << std::setw(12) << latency.maxNanos << std::endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    if (!options.parse(argc, argv)) {
+        return 1;
+    }
+    if (!options.pinCurrentThread()) {
+        std::cerr << "Could not pin to CPU " << options.pinCpu << std::endl;
+    }
+    options.log(std::cout);
+
+    benchGenerators();
+    benchOracleScan();
+    benchLatency();
+    benchEngineRecycling();
+    benchSetOverlap();
+    benchSortedSetOps();
+    benchGroupedDistinct();
+    benchThreadScaling();
+    benchNumaPlacement();
+    return 0;
+}
@@ -1,116 +1,980 @@
 #include "CardinalityEstimation.h"
+#include "engine/LatencyRecorder.h"
+#include "engine/SortedSetOps.h"
+#include "executer/DataExecuterDemo.h"
+#include "executer/DataGenerator.h"
+#include "harness/HarnessOptions.h"
+#include <algorithm>
 #include <iostream>
-#include <random>
 #include <chrono>
 #include <cmath>
 #include <iomanip>
-#include <functional>
+#include <iterator>
+#include <thread>
+#include <unordered_map>
+#include <atomic>
+
+// Every test draws its data from options.seed, so runs are repeatable; see HarnessOptions for the flags
+HarnessOptions options(42, 0);
+
+// Exact number of distinct tuples, the value estimate() should approach
+double countDistinct(std::vector<std::tuple<int,int>> tuples) {
+    std::sort(tuples.begin(), tuples.end());
+    return static_cast<double>(std::unique(tuples.begin(), tuples.end()) - tuples.begin());
+}
 
 // Helper function to run a test case
 void runTest(const std::string& testName, 
             int numTuples,
-            std::function<std::tuple<int,int>()> generator) {
+            const DataSpec& spec) {
     CEEngine engine;
+    // Generated up front so the timed loop measures the engine only
+    std::vector<std::tuple<int,int>> tuples = DataGenerator(spec, options.seed).generate(numTuples);
     
     std::cout << "\n=== " << testName << " ===" << std::endl;
     std::cout << "Inserting " << numTuples << " tuples..." << std::endl;
     
+    for (int w = 0; w < options.warmupRuns; ++w) {
+        CEEngine warmup;
+        for (const auto& tuple : tuples) {
+            warmup.insertTuple(tuple);
+        }
+    }
+    
     auto start = std::chrono::high_resolution_clock::now();
     
-    for (int i = 0; i < numTuples; ++i) {
-        engine.insertTuple(generator());
+    for (const auto& tuple : tuples) {
+        engine.insertTuple(tuple);
     }
     
     auto end = std::chrono::high_resolution_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
     
     double estimate = engine.estimate();
-    double error = std::abs(estimate - numTuples) / numTuples * 100;
+    double distinct = countDistinct(tuples);
+    double error = std::abs(estimate - distinct) / distinct * 100;
     
     std::cout << std::fixed << std::setprecision(3);
     std::cout << "Insertion time: " << duration.count() << "ms" << std::endl;
+    std::cout << "True cardinality: " << static_cast<int>(distinct) << std::endl;
+    std::cout << "Estimated cardinality: " << static_cast<int>(estimate) << std::endl;
+    std::cout << "Error rate: " << error << "%" << std::endl;
+}
+
+// Same as runTest, but feeds the engine through submit() in batches
+void runStreamingTest(const std::string& testName,
+                      int numTuples,
+                      int batchSize,
+                      const DataSpec& spec) {
+    CEEngine engine;
+    std::vector<std::tuple<int,int>> tuples = DataGenerator(spec, options.seed).generate(numTuples);
+    for (int w = 0; w < options.warmupRuns; ++w) {
+        CEEngine warmup;
+        warmup.insertTuples(tuples);
+    }
+
+    std::cout << "\n=== " << testName << " ===" << std::endl;
+    std::cout << "Submitting " << numTuples << " tuples in batches of " << batchSize << "..." << std::endl;
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    std::vector<std::tuple<int,int>> batch;
+    for (int i = 0; i < numTuples; ++i) {
+        batch.push_back(tuples[i]);
+        if (static_cast<int>(batch.size()) == batchSize || i == numTuples - 1) {
+            engine.submit(std::move(batch));
+            batch = {};
+        }
+    }
+    engine.flush();
+
+    auto end = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+
+    double estimate = engine.estimate();
+    double distinct = countDistinct(tuples);
+    double error = std::abs(estimate - distinct) / distinct * 100;
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "Insertion time: " << duration.count() << "ms" << std::endl;
+    std::cout << "True cardinality: " << static_cast<int>(distinct) << std::endl;
+    std::cout << "Estimated cardinality: " << static_cast<int>(estimate) << std::endl;
+    std::cout << "Error rate: " << error << "%" << std::endl;
+}
+
+// Same as runTest, but inserts one large batch through insertTuples with the given config
+void runBatchTest(const std::string& testName,
+                  int numTuples,
+                  const CEConfig& config,
+                  const DataSpec& spec) {
+    CEEngine engine(config);
+
+    std::cout << "\n=== " << testName << " ===" << std::endl;
+    std::cout << "Inserting " << numTuples << " tuples with " << config.numThreads << " threads..." << std::endl;
+
+    std::vector<std::tuple<int,int>> batch = DataGenerator(spec, options.seed).generate(numTuples);
+    for (int w = 0; w < options.warmupRuns; ++w) {
+        CEEngine warmup(config);
+        warmup.insertTuples(batch);
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    // A small first batch finishes the exact-count phase so the large one takes the parallel path
+    engine.insertTuples(std::vector<std::tuple<int,int>>(batch.begin(), batch.begin() + numTuples / 10));
+    engine.insertTuples(std::vector<std::tuple<int,int>>(batch.begin() + numTuples / 10, batch.end()));
+    auto end = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+
+    double estimate = engine.estimate();
+    double distinct = countDistinct(batch);
+    double error = std::abs(estimate - distinct) / distinct * 100;
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "Insertion time: " << duration.count() << "ms" << std::endl;
+    std::cout << "True cardinality: " << static_cast<int>(distinct) << std::endl;
+    std::cout << "Estimated cardinality: " << static_cast<int>(estimate) << std::endl;
+    std::cout << "Error rate: " << error << "%" << std::endl;
+}
+
+// Reads snapshots on one thread while another thread inserts, reporting reader latency
+void runSnapshotTest(const std::string& testName, int numTuples, int batchSize) {
+    CEEngine engine;
+
+    std::cout << "\n=== " << testName << " ===" << std::endl;
+    std::cout << "Inserting " << numTuples << " tuples while reading snapshots..." << std::endl;
+
+    std::atomic<bool> done(false);
+    std::thread writer([&]() {
+        std::vector<std::tuple<int,int>> batch;
+        for (int i = 0; i < numTuples; ++i) {
+            batch.push_back(std::make_tuple(i, i + 1));
+            if (static_cast<int>(batch.size()) == batchSize) {
+                engine.insertTuples(batch);
+                batch.clear();
+            }
+        }
+        engine.insertTuples(batch);
+        engine.publish();
+        done = true;
+    });
+
+    long long reads = 0;
+    long long maxNanos = 0;
+    uint64_t lastVersion = 0;
+    bool monotonic = true;
+    while (!done) {
+        auto start = std::chrono::high_resolution_clock::now();
+        std::shared_ptr<const CESnapshot> snapshot = engine.snapshot();
+        auto end = std::chrono::high_resolution_clock::now();
+        maxNanos = std::max<long long>(maxNanos, std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+        monotonic = monotonic && snapshot->version() >= lastVersion;
+        lastVersion = snapshot->version();
+        reads++;
+    }
+    writer.join();
+
+    double estimate = engine.snapshot()->estimate();
+    double error = std::abs(estimate - numTuples) / numTuples * 100;
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "Snapshot reads: " << reads << " (max latency " << maxNanos << "ns, versions "
+              << (monotonic ? "monotonic" : "NOT monotonic") << ")" << std::endl;
     std::cout << "True cardinality: " << numTuples << std::endl;
     std::cout << "Estimated cardinality: " << static_cast<int>(estimate) << std::endl;
     std::cout << "Error rate: " << error << "%" << std::endl;
 }
 
-int main() {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    
+// Loads the demo executer's base data, then deletes tuples in CDC-sized batches resolved through the executer
+void runBulkDeleteTest(const std::string& testName, int numTuples, int numDeletes, int batchSize) {
+    DataExecuterDemo executer(numTuples - 1, 0, DataSpec(), options.seed);
+    std::vector<std::vector<int>> rows;
+    executer.readTuples(0, numTuples, rows);
+
+    CEEngine engine;
+    std::vector<std::tuple<int,int>> batch;
+    batch.reserve(rows.size());
+    for (const auto& row : rows) {
+        // Column 0 is folded to 100 values so its frequencies are easy to check
+        batch.push_back(std::make_tuple(row[0] % 100, row[1]));
+    }
+    engine.insertTuples(batch);
+
+    std::cout << "\n=== " << testName << " ===" << std::endl;
+    std::cout << "Deleting " << numDeletes << " of " << numTuples << " tuples in batches of " << batchSize << "..." << std::endl;
+
+    int deletedSeven = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int first = 0; first < numDeletes; first += batchSize) {
+        std::vector<int> ids;
+        for (int id = first; id < std::min(numDeletes, first + batchSize); ++id) {
+            ids.push_back(id);
+        }
+        std::vector<std::tuple<int,int>> removed;
+        executer.deleteTuples(ids, removed);
+        for (auto& tuple : removed) {
+            std::get<0>(tuple) %= 100;
+            deletedSeven += std::get<0>(tuple) == 7;
+        }
+        engine.deleteTuples(removed);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+
+    int trueSeven = 0;
+    for (const auto& tuple : batch) {
+        trueSeven += std::get<0>(tuple) == 7;
+    }
+    trueSeven -= deletedSeven;
+    engine.publish();
+
+    std::cout << "Delete time: " << duration.count() << "us" << std::endl;
+    std::cout << "Live tuples: " << engine.snapshot()->tupleCount() << " (expected " << numTuples - numDeletes << ")" << std::endl;
+    std::cout << "Frequency of column 0 = 7: " << engine.estimateFrequency(0, 7) << " (true " << trueSeven << ")" << std::endl;
+}
+
+// Replays demo actions against an engine attached to the executer, then resyncs to remove delete drift
+void runResyncTest(const std::string& testName, int numTuples, int numActions, int bulkDeletes) {
+    DataExecuterDemo executer(numTuples - 1, numActions, DataSpec(), options.seed);
+    CEConfig config;
+    config.resyncCpuFraction = 0.5;
+    CEEngine engine(numTuples, &executer, config);
+    engine.prepare();
+
+    std::cout << "\n=== " << testName << " ===" << std::endl;
+    std::cout << "Replaying " << numActions << " actions and " << bulkDeletes << " bulk deletes on "
+              << numTuples << " tuples..." << std::endl;
+
+    int live = numTuples;
+    int nextId = numTuples;
+    for (Action action = executer.getNextAction(); action.actionType != NONE; action = executer.getNextAction()) {
+        if (action.actionType == INSERT) {
+            engine.insertTuple(std::make_tuple(action.actionTuple[0], action.actionTuple[1]));
+            live++;
+            nextId++;
+        } else if (action.actionType == DELETE) {
+            engine.deleteTuple(std::make_tuple(action.actionTuple[0], action.actionTuple[1]), action.tupleId);
+            live--;
+        }
+    }
+    std::vector<int> ids;
+    for (int id = 0; id < nextId && static_cast<int>(ids.size()) < bulkDeletes; id += 2) {
+        ids.push_back(id);
+    }
+    std::vector<std::tuple<int,int>> removed;
+    executer.deleteTuples(ids, removed);
+    std::vector<int> removedIds(ids.begin(), ids.begin() + removed.size());
+    engine.deleteTuples(removed, removedIds);
+    live -= static_cast<int>(removed.size());
+
+    double before = engine.estimate();
+    auto start = std::chrono::high_resolution_clock::now();
+    engine.resync();
+    auto end = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    double after = engine.estimate();
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "Resync time (50% CPU budget): " << duration.count() << "ms" << std::endl;
+    std::cout << "True cardinality: " << live << std::endl;
+    std::cout << "Estimated before resync: " << static_cast<int>(before)
+              << " (error " << std::abs(before - live) / live * 100 << "%)" << std::endl;
+    std::cout << "Estimated after resync: " << static_cast<int>(after)
+              << " (error " << std::abs(after - live) / live * 100 << "%)" << std::endl;
+}
+
+void runQueryTest(const std::string& testName, int numTuples, int numActions) {
+    DataExecuterDemo executer(numTuples - 1, numActions, DataSpec(), options.seed);
+    CEEngine engine(numTuples, &executer);
+    engine.prepare();
+
+    std::cout << "\n=== " << testName << " ===" << std::endl;
+    std::cout << "Replaying " << numActions << " actions on " << numTuples << " tuples..." << std::endl;
+
+    int queries = 0;
+    double totalError = 0;
+    std::chrono::nanoseconds queryTime(0);
+    for (Action action = executer.getNextAction(); action.actionType != NONE; action = executer.getNextAction()) {
+        if (action.actionType == INSERT) {
+            engine.insertTuple(std::make_tuple(action.actionTuple[0], action.actionTuple[1]));
+        } else if (action.actionType == DELETE) {
+            engine.deleteTuple(std::make_tuple(action.actionTuple[0], action.actionTuple[1]), action.tupleId);
+        } else if (action.actionType == QUERY) {
+            // Queries read the published snapshot
+            engine.publish();
+            auto start = std::chrono::high_resolution_clock::now();
+            int ans = engine.query(action.quals);
+            queryTime += std::chrono::high_resolution_clock::now() - start;
+            totalError += executer.answer(ans);
+            queries++;
+        }
+    }
+    auto start = std::chrono::high_resolution_clock::now();
+    bool completed = engine.resync();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - start);
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "Queries: " << queries << std::endl;
+    std::cout << "Mean log error: " << totalError / std::max(queries, 1) << std::endl;
+    std::cout << "Time per query: " << queryTime.count() / 1000.0 / std::max(queries, 1) << "us" << std::endl;
+    std::cout << "Block resync: " << duration.count() << "ms" << (completed ? "" : " (incomplete)") << std::endl;
+}
+
+// Several engines share one memory budget, each fed its own data; compares their estimates and memory with an
+// unconstrained engine fed the same tuples
+void runMemoryBudgetTest(const std::string& testName, int numEngines, int numTuples, size_t limitBytes) {
+    std::shared_ptr<CEMemoryBudget> budget(new CEMemoryBudget(limitBytes));
+    CEConfig config;
+    config.memoryBudget = budget;
+    std::vector<std::unique_ptr<CEEngine>> engines;
+    for (int e = 0; e < numEngines; ++e) {
+        engines.emplace_back(new CEEngine(config));
+    }
+
+    std::cout << "\n=== " << testName << " ===" << std::endl;
+    std::cout << numEngines << " engines x " << numTuples << " tuples, budget " << limitBytes / 1024 << "KB" << std::endl;
+
+    DataSpec spec;
+    double worstError = 0;
+    CEEngine unconstrained;
+    for (int e = 0; e < numEngines; ++e) {
+        std::vector<std::tuple<int,int>> tuples = DataGenerator(spec, options.seed + e).generate(numTuples);
+        for (size_t i = 0; i < tuples.size(); i += 65536) {
+            std::vector<std::tuple<int,int>> batch(tuples.begin() + i,
+                                                   tuples.begin() + std::min(tuples.size(), i + 65536));
+            engines[e]->insertTuples(batch);
+            if (e == 0) {
+                unconstrained.insertTuples(batch);
+            }
+        }
+        double distinct = countDistinct(tuples);
+        worstError = std::max(worstError, std::abs(engines[e]->estimate() - distinct) / distinct * 100);
+    }
+
+    CEMemoryUsage first = engines[0]->memoryUsage();
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "Budget used: " << budget->used() / 1024 << "KB of " << budget->limit() / 1024 << "KB" << std::endl;
+    std::cout << "Engine 0: " << first.total() / 1024 << "KB (sample " << first.sample / 1024
+              << "KB, distinct " << first.distinctSketch / 1024 << "KB, counts " << first.columnCounts / 1024
+              << "KB, blocks " << first.blockSummaries / 1024 << "KB), unconstrained "
+              << unconstrained.memoryUsage().total() / 1024 << "KB" << std::endl;
+    std::cout << "Sample kept: " << engines[0]->sample().size() << " tuples" << std::endl;
+    std::cout << "Worst error rate: " << worstError << "%" << std::endl;
+}
+
+// Short-lived engines recycled through a pool must answer exactly like fresh ones
+void runEnginePoolTest(const std::string& testName, int numCycles, int tuplesPerCycle) {
+    std::cout << "\n=== " << testName << " ===" << std::endl;
+    std::cout << numCycles << " engines x " << tuplesPerCycle << " tuples..." << std::endl;
+
+    CEEnginePool& pool = CEEnginePool::local();
+    DataGenerator generator(DataSpec(), options.seed);
+    int mismatches = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int cycle = 0; cycle < numCycles; ++cycle) {
+        // Alternate small and large results so recycled engines also cross the exact-count limit
+        std::vector<std::tuple<int,int>> tuples = generator.generate(cycle % 2 ? tuplesPerCycle : tuplesPerCycle * 20);
+        std::unique_ptr<CEEngine> engine = pool.acquire();
+        engine->insertTuples(tuples);
+        engine->publish();
+        CEEngine fresh;
+        fresh.insertTuples(tuples);
+        fresh.publish();
+        if (engine->estimate() != fresh.estimate() || engine->query({{0, GREATER, 0}}) != fresh.query({{0, GREATER, 0}})) {
+            mismatches++;
+        }
+        pool.release(std::move(engine));
+    }
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - start);
+
+    std::cout << "Cycle time: " << duration.count() << "ms" << std::endl;
+    std::cout << "Engines idle in pool: " << pool.idle() << std::endl;
+    std::cout << "Recycled engines differing from fresh ones: " << mismatches << std::endl;
+}
+
+// Equi-join size on column 0 of two independently filled engines, against the exact size from value counts
+void runJoinTest(const std::string& testName, int numTuples, const DataSpec& spec) {
+    std::cout << "\n=== " << testName << " ===" << std::endl;
+    std::cout << numTuples << " x " << numTuples << " tuples, join on column 0..." << std::endl;
+
+    std::vector<std::tuple<int,int>> left = DataGenerator(spec, options.seed).generate(numTuples);
+    std::vector<std::tuple<int,int>> right = DataGenerator(spec, options.seed + 1).generate(numTuples);
+    CEEngine leftEngine;
+    CEEngine rightEngine;
+    leftEngine.insertTuples(left);
+    rightEngine.insertTuples(right);
+
+    std::unordered_map<int, double> leftCounts;
+    for (const auto& tuple : left) {
+        leftCounts[std::get<0>(tuple)]++;
+    }
+    double trueSize = 0;
+    for (const auto& tuple : right) {
+        auto it = leftCounts.find(std::get<0>(tuple));
+        if (it != leftCounts.end()) {
+            trueSize += it->second;
+        }
+    }
+
+    const int calls = 1000;
+    CEJoinEstimate join;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < calls; ++i) {
+        join = leftEngine.estimateJoin(0, rightEngine, 0);
+    }
+    auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::high_resolution_clock::now() - start);
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "True join size: " << trueSize << std::endl;
+    std::cout << "Estimated join size: " << join.estimate << " (error "
+              << std::abs(join.estimate - trueSize) / trueSize * 100 << "%)" << std::endl;
+    std::cout << "Upper bound: " << join.upperBound << " (+" << join.maxOvercount << " at most)" << std::endl;
+    std::cout << "Time per estimate: " << duration.count() / 1000.0 / calls << "us" << std::endl;
+}
+
+// Two engines sharing part of their tuples: intersection and differences from their k-minimum-values sketches
+void runOverlapTest(const std::string& testName, int sharedTuples, int ownTuples) {
+    std::cout << "\n=== " << testName << " ===" << std::endl;
+    std::cout << sharedTuples << " shared + " << ownTuples << " own tuples per engine..." << std::endl;
+
+    DataSpec spec;
+    std::vector<std::tuple<int,int>> shared = DataGenerator(spec, options.seed).generate(sharedTuples);
+    std::vector<std::tuple<int,int>> left = DataGenerator(spec, options.seed + 1).generate(ownTuples);
+    std::vector<std::tuple<int,int>> right = DataGenerator(spec, options.seed + 2).generate(ownTuples);
+    left.insert(left.end(), shared.begin(), shared.end());
+    right.insert(right.end(), shared.begin(), shared.end());
+    CEEngine leftEngine;
+    CEEngine rightEngine;
+    leftEngine.insertTuples(left);
+    rightEngine.insertTuples(right);
+
+    std::vector<std::tuple<int,int>> both(left);
+    both.insert(both.end(), right.begin(), right.end());
+    const double unionSize = countDistinct(both);
+    const double trueIntersection = countDistinct(left) + countDistinct(right) - unionSize;
+    const double trueLeftOnly = unionSize - countDistinct(right);
+
+    // The first call sorts hashes still buffered by the sketches; time the calls after it
+    CEOverlap overlap = leftEngine.estimateOverlap(rightEngine);
+    const int calls = 100;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < calls; ++i) {
+        overlap = leftEngine.estimateOverlap(rightEngine);
+    }
+    auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::high_resolution_clock::now() - start);
+    const double inclusionExclusion = leftEngine.estimate() + rightEngine.estimate() - unionSize;
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "True intersection: " << trueIntersection << ", left only: " << trueLeftOnly << std::endl;
+    std::cout << "Estimated intersection: " << overlap.intersection << " (error "
+              << std::abs(overlap.intersection - trueIntersection) / trueIntersection * 100 << "%)" << std::endl;
+    std::cout << "Estimated left only: " << overlap.leftOnly << " (error "
+              << std::abs(overlap.leftOnly - trueLeftOnly) / trueLeftOnly * 100 << "%)" << std::endl;
+    std::cout << "Inclusion-exclusion with the exact union: " << inclusionExclusion << " (error "
+              << std::abs(inclusionExclusion - trueIntersection) / trueIntersection * 100 << "%)" << std::endl;
+    std::cout << "Time per estimate: " << duration.count() / 1000.0 / calls << "us" << std::endl;
+}
+
+// Set expressions over four partition engines from their theta sketches, against exact set algebra on the tuples.
+// Also checks that the AVX2 and scalar sorted-set kernels agree.
+void runThetaAlgebraTest(const std::string& testName, int groupSize) {
+    std::cout << "\n=== " << testName << " ===" << std::endl;
+    std::cout << "4 partitions, overlapping groups of " << groupSize << " tuples..." << std::endl;
+
+    // Group g goes to the partitions in members[g]: one group shared by all, three shared by pairs, one own per part
+    const std::vector<std::vector<int>> members = {{0, 1, 2, 3}, {0, 1}, {2, 3}, {0, 2}, {0}, {1}, {2}, {3}};
+    std::vector<std::vector<std::tuple<int,int>>> partitions(4);
+    std::vector<std::vector<uint64_t>> exact(4);
+    for (size_t g = 0; g < members.size(); ++g) {
+        std::vector<std::tuple<int,int>> group = DataGenerator(DataSpec(), options.seed + g).generate(groupSize);
+        for (int p : members[g]) {
+            partitions[p].insert(partitions[p].end(), group.begin(), group.end());
+        }
+    }
+    std::vector<std::unique_ptr<CEEngine>> engines;
+    std::vector<ThetaSketch> sketches;
+    for (int p = 0; p < 4; ++p) {
+        engines.emplace_back(new CEEngine());
+        engines[p]->insertTuples(partitions[p]);
+        sketches.push_back(engines[p]->thetaSketch());
+        for (const auto& tuple : partitions[p]) {
+            exact[p].push_back((static_cast<uint64_t>(std::get<0>(tuple)) << 32) |
+                               static_cast<uint32_t>(std::get<1>(tuple)));
+        }
+        std::sort(exact[p].begin(), exact[p].end());
+        exact[p].erase(std::unique(exact[p].begin(), exact[p].end()), exact[p].end());
+    }
+    auto setUnion = [](const std::vector<uint64_t>& a, const std::vector<uint64_t>& b) {
+        std::vector<uint64_t> out;
+        std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(out));
+        return out;
+    };
+    auto setIntersection = [](const std::vector<uint64_t>& a, const std::vector<uint64_t>& b) {
+        std::vector<uint64_t> out;
+        std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(out));
+        return out;
+    };
+    auto setDifference = [](const std::vector<uint64_t>& a, const std::vector<uint64_t>& b) {
+        std::vector<uint64_t> out;
+        std::set_difference(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(out));
+        return out;
+    };
+
+    auto report = [](const std::string& name, const ThetaSketch& sketch, size_t truth) {
+        const bool covered = sketch.lowerBound() <= truth && truth <= sketch.upperBound();
+        std::cout << std::fixed << std::setprecision(1) << name << ": true " << truth << ", estimated "
+                  << sketch.estimate() << " [" << sketch.lowerBound() << ", " << sketch.upperBound() << "] (error "
+                  << std::setprecision(3) << std::abs(sketch.estimate() - truth) / truth * 100 << "%"
+                  << (covered ? "" : ", outside bounds") << ")" << std::endl;
+    };
+    report("(P0 | P1) & (P2 | P3)",
+           ThetaSketch::intersect(ThetaSketch::unite(sketches[0], sketches[1]),
+                                  ThetaSketch::unite(sketches[2], sketches[3])),
+           setIntersection(setUnion(exact[0], exact[1]), setUnion(exact[2], exact[3])).size());
+    report("P0 - P1", ThetaSketch::aNotB(sketches[0], sketches[1]), setDifference(exact[0], exact[1]).size());
+    report("P0 & P1 & P2 & P3", ThetaSketch::intersectAll({&sketches[0], &sketches[1], &sketches[2], &sketches[3]}),
+           setIntersection(setIntersection(exact[0], exact[1]), setIntersection(exact[2], exact[3])).size());
+    report("P0 | P1 | P2 | P3", ThetaSketch::uniteAll({&sketches[0], &sketches[1], &sketches[2], &sketches[3]}),
+           setUnion(setUnion(exact[0], exact[1]), setUnion(exact[2], exact[3])).size());
+
+    // Random sorted arrays with every kind of overlap, through both kernels
+    DataGenerator generator(DataSpec(), options.seed);
+    int kernelMismatches = 0;
+    for (int round = 0; round < 200; ++round) {
+        std::vector<uint64_t> a(generator.uniform(300));
+        std::vector<uint64_t> b(generator.uniform(300));
+        const uint32_t range = 1 + generator.uniform(1000);
+        for (auto* values : {&a, &b}) {
+            for (auto& value : *values) {
+                value = generator.uniform(range);
+            }
+            std::sort(values->begin(), values->end());
+            values->erase(std::unique(values->begin(), values->end()), values->end());
+        }
+        std::vector<uint64_t> simd(a.size() + b.size()), scalar(a.size() + b.size());
+        size_t n = intersectSorted(a.data(), a.size(), b.data(), b.size(), simd.data(), true);
+        if (n != intersectSorted(a.data(), a.size(), b.data(), b.size(), scalar.data(), false) ||
+            !std::equal(simd.begin(), simd.begin() + n, scalar.begin()) || n != setIntersection(a, b).size()) {
+            kernelMismatches++;
+        }
+        n = differenceSorted(a.data(), a.size(), b.data(), b.size(), simd.data(), true);
+        if (n != differenceSorted(a.data(), a.size(), b.data(), b.size(), scalar.data(), false) ||
+            !std::equal(simd.begin(), simd.begin() + n, scalar.begin()) || n != setDifference(a, b).size()) {
+            kernelMismatches++;
+        }
+    }
+    std::cout << "AVX2 kernels: " << (sortedSetSimdSupported() ? "available" : "not available")
+              << ", mismatches against scalar: " << kernelMismatches << std::endl;
+}
+
+// Distinct column 1 values per column 0 value, against exact per-group counts. Memory is compared with what one
+// dense HyperLogLog per group would take.
+void runGroupedDistinctTest(const std::string& testName, int numTuples, const DataSpec& spec) {
+    std::cout << "\n=== " << testName << " ===" << std::endl;
+    std::cout << numTuples << " tuples, grouped by column 0..." << std::endl;
+
+    std::vector<std::tuple<int,int>> tuples = DataGenerator(spec, options.seed).generate(numTuples);
+    CEConfig config;
+    config.groupedDistinct = true;
+    CEEngine engine(config);
+    auto start = std::chrono::high_resolution_clock::now();
+    engine.insertTuples(tuples);
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - start);
+
+    std::unordered_map<int, std::vector<int>> exact;
+    for (const auto& tuple : tuples) {
+        exact[std::get<0>(tuple)].push_back(std::get<1>(tuple));
+    }
+    double sumError = 0;
+    double maxError = 0;
+    double maxLargeError = 0;  // among groups with at least 1000 distinct values
+    int64_t distinctPairs = 0;
+    for (auto& entry : exact) {
+        std::vector<int>& values = entry.second;
+        std::sort(values.begin(), values.end());
+        const double truth = static_cast<double>(std::unique(values.begin(), values.end()) - values.begin());
+        distinctPairs += static_cast<int64_t>(truth);
+        const double error = std::abs(engine.estimateGroupDistinct(entry.first) - truth) / truth;
+        sumError += error;
+        maxError = std::max(maxError, error);
+        if (truth >= 1000) {
+            maxLargeError = std::max(maxLargeError, error);
+        }
+    }
+
+    const size_t groupBytes = engine.memoryUsage().groupSketches;
+    const double denseBytes = static_cast<double>(exact.size()) * (1 << 14);
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "Groups: " << engine.groupCount() << " (exact " << exact.size() << "), distinct pairs: "
+              << distinctPairs << std::endl;
+    std::cout << "Mean error: " << sumError / exact.size() * 100 << "%, max error: " << maxError * 100
+              << "%, max error over groups of 1000+: " << maxLargeError * 100 << "%" << std::endl;
+    std::cout << "Group sketch memory: " << groupBytes / 1024.0 << "KB (" << groupBytes / double(distinctPairs)
+              << " bytes per distinct pair, dense per group would take " << denseBytes / (1 << 20) << "MB)"
+              << std::endl;
+    std::cout << "Insert time: " << duration.count() << "ms" << std::endl;
+}
+
+// Intervals from estimateWithBounds, estimateFrequencyWithBounds and queryWithBounds against exact answers: how often
+// each one holds the true value, and how wide it is
+void runBoundsTest(const std::string& testName, int numTuples, int numActions) {
+    std::cout << "\n=== " << testName << " ===" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+
+    // Distinct counts of independent data sets, so coverage can be counted
+    const int numEngines = 20;
+    int covered = 0;
+    double width = 0;
+    for (int e = 0; e < numEngines; ++e) {
+        std::vector<std::tuple<int,int>> tuples = DataGenerator(DataSpec(), options.seed + e).generate(numTuples);
+        CEEngine engine;
+        engine.insertTuples(tuples);
+        const CEBounds bounds = engine.estimateWithBounds();
+        const double truth = countDistinct(tuples);
+        covered += bounds.lower <= truth && truth <= bounds.upper;
+        width += (bounds.upper - bounds.lower) / truth;
+    }
+    std::cout << "Distinct count: " << covered << "/" << numEngines << " intervals hold the true value, mean width "
+              << width / numEngines * 100 << "% of it (2 standard errors)" << std::endl;
+
+    // Filter queries and frequencies on skewed data, replayed with deletes against the demo executer
+    DataSpec spec;
+    spec.distribution = Distribution::ZIPF;
+    spec.maxValue = 100000;
+    DataExecuterDemo executer(numTuples - 1, numActions, spec, options.seed);
+    CEEngine engine(numTuples, &executer);
+    engine.prepare();
+    int queries = 0;
+    int queriesCovered = 0;
+    double queryWidth = 0;
+    double queryTruth = 0;
+    double minConfidence = 1;
+    for (Action action = executer.getNextAction(); action.actionType != NONE; action = executer.getNextAction()) {
+        if (action.actionType == INSERT) {
+            engine.insertTuple(std::make_tuple(action.actionTuple[0], action.actionTuple[1]));
+        } else if (action.actionType == DELETE) {
+            engine.deleteTuple(std::make_tuple(action.actionTuple[0], action.actionTuple[1]), action.tupleId);
+        } else if (action.actionType == QUERY) {
+            engine.publish();
+            const CEBounds bounds = engine.queryWithBounds(action.quals);
+            const int truth = executer.countMatches(action.quals);
+            queriesCovered += bounds.lower <= truth && truth <= bounds.upper;
+            queryWidth += bounds.upper - bounds.lower;
+            queryTruth += truth;
+            minConfidence = std::min(minConfidence, bounds.confidence);
+            queries++;
+        }
+    }
+    std::cout << "Queries: " << queriesCovered << "/" << queries << " intervals hold the true count, mean width "
+              << queryWidth / std::max(queries, 1) << " rows (mean true count " << queryTruth / std::max(queries, 1)
+              << "), lowest confidence " << minConfidence << std::endl;
+
+    int frequenciesCovered = 0;
+    double frequencyWidth = 0;
+    const std::vector<std::tuple<int,int>> probes = DataGenerator(spec, options.seed + numEngines).generate(1000);
+    for (const auto& probe : probes) {
+        const CEBounds bounds = engine.estimateFrequencyWithBounds(0, std::get<0>(probe));
+        const int truth = executer.countMatches({CompareExpression{0, EQUAL, std::get<0>(probe)}});
+        frequenciesCovered += bounds.lower <= truth && truth <= bounds.upper;
+        frequencyWidth += bounds.upper - bounds.lower;
+    }
+    std::cout << "Column 0 frequencies: " << frequenciesCovered << "/" << probes.size()
+              << " intervals hold the true count, mean width " << frequencyWidth / probes.size()
+              << " rows (confidence " << engine.estimateFrequencyWithBounds(0, 0).confidence << ")" << std::endl;
+}
+
+// Two engines, each fed by its own demo executer with the same seed, take the same actions side by side; only one
+// reports every query's true count through recordFeedback. Compares their mean log error over each quarter of the
+// run, as the feedback model fills in.
+void runFeedbackTest(const std::string& testName, int numTuples, int numActions, const DataSpec& spec) {
+    std::cout << "\n=== " << testName << " ===" << std::endl;
+    std::cout << "Replaying " << numActions << " actions on " << numTuples << " tuples into two engines side by side..."
+              << std::endl;
+
+    DataExecuterDemo plainExecuter(numTuples - 1, numActions, spec, options.seed);
+    DataExecuterDemo learningExecuter(numTuples - 1, numActions, spec, options.seed);
+    CEEngine plain(numTuples, &plainExecuter);
+    CEEngine learning(numTuples, &learningExecuter);
+    plain.prepare();
+    learning.prepare();
+
+    const int quarters = 4;
+    const int queriesPerQuarter = std::max(1, numActions / 100 / quarters);
+    std::vector<double> plainError(quarters, 0);
+    std::vector<double> learningError(quarters, 0);
+    std::chrono::nanoseconds plainTime(0);
+    std::chrono::nanoseconds learningTime(0);
+    int queries = 0;
+    for (Action action = plainExecuter.getNextAction(); action.actionType != NONE;
+         action = plainExecuter.getNextAction()) {
+        learningExecuter.getNextAction();
+        if (action.actionType == INSERT) {
+            const std::tuple<int,int> tuple(action.actionTuple[0], action.actionTuple[1]);
+            plain.insertTuple(tuple);
+            learning.insertTuple(tuple);
+        } else if (action.actionType == DELETE) {
+            const std::tuple<int,int> tuple(action.actionTuple[0], action.actionTuple[1]);
+            plain.deleteTuple(tuple, action.tupleId);
+            learning.deleteTuple(tuple, action.tupleId);
+        } else if (action.actionType == QUERY) {
+            plain.publish();
+            learning.publish();
+            auto start = std::chrono::high_resolution_clock::now();
+            const int plainAnswer = plain.query(action.quals);
+            auto mid = std::chrono::high_resolution_clock::now();
+            CEQueryTrace trace;
+            const int learningAnswer = learning.query(action.quals, &trace);
+            learningTime += std::chrono::high_resolution_clock::now() - mid;
+            plainTime += mid - start;
+            const int quarter = std::min(quarters - 1, queries / queriesPerQuarter);
+            plainError[quarter] += plainExecuter.answer(plainAnswer);
+            learningError[quarter] += learningExecuter.answer(learningAnswer);
+            learning.recordFeedback(trace, learningExecuter.countMatches(action.quals));
+            queries++;
+        }
+    }
+    learning.flushFeedback();
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "Mean log error by quarter (without / with feedback):";
+    for (int q = 0; q < quarters; ++q) {
+        const int inQuarter = q < quarters - 1 ? queriesPerQuarter : queries - (quarters - 1) * queriesPerQuarter;
+        std::cout << " " << plainError[q] / std::max(inQuarter, 1) << " / " << learningError[q] / std::max(inQuarter, 1);
+    }
+    std::cout << std::endl;
+    std::cout << "Feedback trained on: " << learning.feedbackSamples() << " of " << queries << " queries" << std::endl;
+    std::cout << "Time per query: " << plainTime.count() / 1000.0 / std::max(queries, 1) << "us without, "
+              << learningTime.count() / 1000.0 / std::max(queries, 1) << "us with feedback" << std::endl;
+}
+
+// One thread timing calls on more recorders than its shard cache holds, as when it serves many engines. Every
+// recorder must keep a single shard for the thread, so shard count and memory stay flat however often the thread
+// rotates, and sampling keeps exactly one of every sampleInterval calls. Returns whether both held.
+bool runLatencyShardTest(const std::string& testName, int numRecorders, int numRounds) {
+    std::cout << "\n=== " << testName << " ===" << std::endl;
+    std::cout << "One thread rotating over " << numRecorders << " recorders for " << numRounds << " rounds..."
+              << std::endl;
+
+    const uint32_t sampleInterval = 16;
+    std::vector<std::unique_ptr<LatencyRecorder>> recorders;
+    for (int r = 0; r < numRecorders; ++r) {
+        recorders.emplace_back(new LatencyRecorder(1, sampleInterval));
+    }
+    auto totals = [&recorders](size_t (LatencyRecorder::*measure)() const) {
+        size_t total = 0;
+        for (const auto& recorder : recorders) {
+            total += ((*recorder).*measure)();
+        }
+        return total;
+    };
+    auto rotate = [&recorders](int rounds) {
+        for (int round = 0; round < rounds; ++round) {
+            for (const auto& recorder : recorders) {
+                LatencyScope scope(*recorder, 0);
+            }
+        }
+    };
+
+    rotate(1);
+    const size_t warmShards = totals(&LatencyRecorder::shardCount);
+    const size_t warmBytes = totals(&LatencyRecorder::memoryUsage);
+    auto start = std::chrono::high_resolution_clock::now();
+    rotate(numRounds - 1);
+    auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::high_resolution_clock::now() - start);
+    const size_t shards = totals(&LatencyRecorder::shardCount);
+    const size_t bytes = totals(&LatencyRecorder::memoryUsage);
+
+    uint64_t timed = 0;
+    for (const auto& recorder : recorders) {
+        timed += recorder->summary(0).count;
+    }
+    const uint64_t expectedTimed = static_cast<uint64_t>(numRecorders) * (numRounds / sampleInterval);
+    const bool flat = shards == warmShards && bytes == warmBytes && shards == static_cast<size_t>(numRecorders);
+
+    std::cout << "Time per call: " << static_cast<double>(duration.count()) / (numRecorders * (numRounds - 1))
+              << "ns" << std::endl;
+    std::cout << "Shards: " << warmShards << " after one round, " << shards << " after " << numRounds << std::endl;
+    std::cout << "Shard memory: " << warmBytes << " bytes after one round, " << bytes << " after " << numRounds
+              << std::endl;
+    std::cout << "Timed calls: " << timed << " (expected " << expectedTimed << ")" << std::endl;
+    std::cout << (flat && timed == expectedTimed ? "Shards stayed flat" : "FAILED: shards grew or sampling reset")
+              << std::endl;
+    return flat && timed == expectedTimed;
+}
+
+int main(int argc, char** argv) {
+    if (!options.parse(argc, argv)) {
+        return 1;
+    }
+    if (!options.pinCurrentThread()) {
+        std::cerr << "Could not pin to CPU " << options.pinCpu << std::endl;
+    }
+    options.log(std::cout);
+    options.startTrace();
+
     // Test 1: Uniform Distribution (Base case)
     {
-        const int NUM_TUPLES = 1000000;
-        const int VALUE_RANGE = 100000;
-        std::uniform_int_distribution<> dis(0, VALUE_RANGE);
+        DataSpec spec;
+        spec.maxValue = 100000;
         
-        runTest("Uniform Distribution", NUM_TUPLES,
-                [&]() { return std::make_tuple(dis(gen), dis(gen)); });
+        runTest("Uniform Distribution", 1000000, spec);
     }
     
-    // Test 2: Skewed Distribution (Zipfian-like)
+    // Test 2: Skewed Distribution (Zipfian)
     {
-        const int NUM_TUPLES = 1000000;
-        const int VALUE_RANGE = 100000;
-        std::exponential_distribution<> exp_dis(0.0001);
-        std::uniform_int_distribution<> offset_dis(0, 1000);
+        DataSpec spec;
+        spec.distribution = Distribution::ZIPF;
+        spec.maxValue = 100000;
+        spec.zipfS = 1.1;
         
-        runTest("Skewed Distribution", NUM_TUPLES,
-                [&]() {
-                    int val = static_cast<int>(exp_dis(gen)) % VALUE_RANGE;
-                    return std::make_tuple(val, val + offset_dis(gen));
-                });
+        runTest("Skewed Distribution", 1000000, spec);
     }
     
     // Test 3: Small Cardinality
     {
-        const int NUM_TUPLES = 100;
-        const int VALUE_RANGE = 50;
-        std::uniform_int_distribution<> small_dis(0, VALUE_RANGE);
+        DataSpec spec;
+        spec.maxValue = 50;
         
-        runTest("Small Cardinality", NUM_TUPLES,
-                [&]() { return std::make_tuple(small_dis(gen), small_dis(gen)); });
+        runTest("Small Cardinality", 100, spec);
     }
     
     // Test 4: Large Cardinality
     {
-        const int NUM_TUPLES = 10000000;
-        const int VALUE_RANGE = 1000000;
-        std::uniform_int_distribution<> large_dis(0, VALUE_RANGE);
+        DataSpec spec;
+        spec.maxValue = 1000000;
         
-        runTest("Large Cardinality", NUM_TUPLES,
-                [&]() { return std::make_tuple(large_dis(gen), large_dis(gen)); });
+        runTest("Large Cardinality", 10000000, spec);
     }
     
     // Test 5: Constant Values (Worst case)
     {
-        const int NUM_TUPLES = 1000000;
+        DataSpec spec;
+        spec.distribution = Distribution::CONSTANT;
+        spec.start = 42;
         
-        runTest("Constant Values", NUM_TUPLES,
-                [&]() { return std::make_tuple(42, 42); });
+        runTest("Constant Values", 1000000, spec);
     }
     
     // Test 6: Sequential Values
     {
-        const int NUM_TUPLES = 1000000;
-        int counter = 0;
+        DataSpec spec;
+        spec.distribution = Distribution::SEQUENTIAL;
         
-        runTest("Sequential Values", NUM_TUPLES,
-                [&counter]() {
-                    int current = counter++;
-                    return std::make_tuple(current, current + 1);
-                });
+        runTest("Sequential Values", 1000000, spec);
     }
     
     // Test 7: Many Duplicates
     {
-        const int NUM_TUPLES = 1000000;
-        const int VALUE_RANGE = 1000;  // Very small range for many duplicates
-        std::uniform_int_distribution<> dup_dis(0, VALUE_RANGE);
+        DataSpec spec;
+        spec.distribution = Distribution::DUPLICATES;
+        spec.distinctTuples = 1000;  // Very small pool for many duplicates
         
-        runTest("Many Duplicates", NUM_TUPLES,
-                [&]() { return std::make_tuple(dup_dis(gen), dup_dis(gen)); });
+        runTest("Many Duplicates", 1000000, spec);
     }
     
-    return 0;
+    // Test 8: Streaming Ingest
+    {
+        DataSpec spec;
+        spec.distribution = Distribution::SEQUENTIAL;
+
+        runStreamingTest("Streaming Ingest", 1000000, 4096, spec);
+    }
+
+    // Test 9: NUMA-sharded parallel insert
+    {
+        DataSpec spec;
+        spec.distribution = Distribution::SEQUENTIAL;
+        CEConfig config;
+        config.numThreads = 4;
+        config.numaSharding = true;
+
+        runBatchTest("Sharded Parallel Insert", 1000000, config, spec);
+    }
+
+    // Test 10: Snapshot reads during concurrent ingest
+    {
+        runSnapshotTest("Concurrent Snapshot Reads", 1000000, 4096);
+    }
+
+    // Test 11: Bulk deletes resolved through the demo executer
+    {
+        runBulkDeleteTest("Bulk Deletes", 200000, 50000, 5000);
+    }
+
+    // Test 12: Resync against the executer after heavy churn
+    {
+        runResyncTest("Resync After Churn", 100000, 50000, 30000);
+    }
+
+    // Test 13: Filter queries answered from per-block summaries
+    {
+        runQueryTest("Block Summary Queries", 200000, 100000);
+    }
+
+    // Test 14: Engines sharing a memory budget
+    {
+        runMemoryBudgetTest("Shared Memory Budget", 4, 1000000, 1 << 20);
+    }
+
+    // Test 15: Engines recycled through a per-thread pool
+    {
+        runEnginePoolTest("Engine Pool", 200, 1000);
+    }
+
+    // Test 16: Join size from two engines' Count-Min counters, skewed and uniform keys
+    {
+        DataSpec spec;
+        spec.distribution = Distribution::ZIPF;
+        runJoinTest("Join Size (Zipf Keys)", 1000000, spec);
+        spec.distribution = Distribution::UNIFORM;
+        spec.maxValue = 100000;
+        runJoinTest("Join Size (Uniform Keys)", 1000000, spec);
+    }
+
+    // Test 17: Intersection and difference of two engines' tuple sets
+    {
+        runOverlapTest("Set Overlap", 50000, 950000);
+    }
+
+    // Test 18: Theta sketch set algebra across partitions
+    {
+        runThetaAlgebraTest("Theta Set Algebra", 100000);
+    }
+
+    // Test 19: Distinct values per group
+    {
+        DataSpec spec;
+        spec.distribution = Distribution::ZIPF;
+        spec.maxValue = 100000;
+        spec.zipfS = 1.1;
+        runGroupedDistinctTest("Grouped Distinct (Zipf)", 1000000, spec);
+        spec.distribution = Distribution::UNIFORM;
+        spec.maxValue = 20000;
+        runGroupedDistinctTest("Grouped Distinct (Uniform)", 1000000, spec);
+    }
+
+    // Test 20: Error bounds returned with estimates, frequencies and queries
+    {
+        runBoundsTest("Error Bounds", 100000, 50000);
+    }
+
+    // Test 21: Query estimates corrected by a model trained on true-count feedback
+    {
+        DataSpec spec;
+        runFeedbackTest("Query Feedback (Uniform)", 200000, 400000, spec);
+        spec.distribution = Distribution::ZIPF;
+        spec.maxValue = 100000;
+        runFeedbackTest("Query Feedback (Zipf)", 200000, 400000, spec);
+    }
+
+    // Test 22: Latency shards stay one per thread when a thread rotates over more recorders than it caches
+    bool shardsFlat = runLatencyShardTest("Latency Shards", 8, 100000);
+
+    options.finishTrace();
+    return shardsFlat ? 0 : 1;
 }
\ No newline at end of file
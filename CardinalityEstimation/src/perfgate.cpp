@@ -0,0 +1,465 @@
+#include "CardinalityEstimation.h"
+#include "engine/CountMinSketch.h"
+#include "engine/HyperLogLog.h"
+#include "executer/DataGenerator.h"
+#include "harness/HarnessOptions.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Performance regression gate. Runs a fixed microbenchmark suite several times and either records the samples as
+// the baseline of this machine profile (JSON under the baseline directory) or compares them with the stored
+// baseline. A benchmark regresses when it is slower by more than the threshold and a one-sided Welch t-test says the
+// slowdown is significant; the process then exits with status 1.
+//
+// Usage: perfgate [record|compare] [--profile NAME] [--baseline-dir DIR] [--runs N] [--threshold PCT]
+//                 [--alpha P] [--seed N] [--pin CPU] [--warmup N]
+
+namespace {
+    HarnessOptions options(12345, 1);
+
+    using Samples = std::vector<double>;
+
+    struct Benchmark {
+        const char* name;
+        // Runs one timed repetition and returns nanoseconds per operation
+        std::function<double()> run;
+    };
+
+    template <typename Fn>
+    double nanosPerOp(size_t ops, Fn fn) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::nano>(end - start).count() / ops;
+    }
+
+    std::vector<uint64_t> makeKeys(size_t n) {
+        std::vector<uint64_t> keys(n);
+        Xoshiro256 rng(options.seed);
+        for (uint64_t& key : keys) {
+            key = rng.next();
+        }
+        return keys;
+    }
+
+    std::vector<Benchmark> makeSuite() {
+        // Inputs are shared by every repetition so runs differ only in timing noise
+        auto keys = std::make_shared<std::vector<uint64_t>>(makeKeys(1 << 20));
+        auto hashes = std::make_shared<std::vector<uint64_t>>(keys->size());
+        for (size_t i = 0; i < keys->size(); ++i) {
+            (*hashes)[i] = HyperLogLog::hashValue((*keys)[i]);
+        }
+        DataSpec uniform;
+        auto tuples = std::make_shared<std::vector<std::tuple<int, int>>>(
+            DataGenerator(uniform, options.seed).generate(1 << 20));
+
+        auto addBench = [keys](HLLRepresentation representation, size_t n) {
+            return [keys, representation, n]() {
+                HyperLogLog sketch(14, representation);
+                return nanosPerOp(n, [&] {
+                    for (size_t i = 0; i < n; ++i) {
+                        sketch.add((*keys)[i]);
+                    }
+                });
+            };
+        };
+
+        std::vector<Benchmark> suite;
+        suite.push_back({"hll.add.exact", addBench(HLLRepresentation::EXACT, 8000)});
+        suite.push_back({"hll.add.sparse", addBench(HLLRepresentation::SPARSE, 1 << 16)});
+        suite.push_back({"hll.add.dense", addBench(HLLRepresentation::DENSE, keys->size())});
+        suite.push_back({"hll.add.packed", addBench(HLLRepresentation::PACKED, keys->size())});
+        suite.push_back({"hll.addHash.dense", [hashes]() {
+            HyperLogLog sketch(14, HLLRepresentation::DENSE);
+            return nanosPerOp(hashes->size(), [&] {
+                for (uint64_t hash : *hashes) {
+                    sketch.addHash(hash);
+                }
+            });
+        }});
+        suite.push_back({"hll.estimate.dense", [hashes]() {
+            HyperLogLog sketch(14, HLLRepresentation::DENSE);
+            for (uint64_t hash : *hashes) {
+                sketch.addHash(hash);
+            }
+            volatile double sink = 0;
+            return nanosPerOp(256, [&] {
+                for (int i = 0; i < 256; ++i) {
+                    sink = sketch.estimate();
+                }
+            });
+        }});
+        suite.push_back({"hll.merge.dense", [hashes]() {
+            HyperLogLog source(14, HLLRepresentation::DENSE);
+            for (uint64_t hash : *hashes) {
+                source.addHash(hash);
+            }
+            HyperLogLog target(14, HLLRepresentation::DENSE);
+            return nanosPerOp(256, [&] {
+                for (int i = 0; i < 256; ++i) {
+                    target.merge(source);
+                }
+            });
+        }});
+        suite.push_back({"hll.reset.p18", [hashes]() {
+            // A recycled sketch: a few updates, then a reset. Registers are 256KB at this precision.
+            HyperLogLog sketch(18, HLLRepresentation::DENSE);
+            return nanosPerOp(4096, [&] {
+                for (size_t i = 0; i < 4096; ++i) {
+                    for (size_t j = 0; j < 16; ++j) {
+                        sketch.addHash((*hashes)[(i * 16 + j) & (hashes->size() - 1)]);
+                    }
+                    sketch.reset();
+                }
+            });
+        }});
+        suite.push_back({"cms.addBatch", [keys]() {
+            CountMinSketch sketch;
+            return nanosPerOp(keys->size(), [&] { sketch.addBatch(keys->data(), keys->size(), 1); });
+        }});
+        suite.push_back({"engine.insertTuples", [tuples]() {
+            CEEngine engine;
+            return nanosPerOp(tuples->size(), [&] { engine.insertTuples(*tuples); });
+        }});
+        suite.push_back({"generator.uniform", [tuples]() {
+            DataGenerator generator(DataSpec(), options.seed);
+            std::vector<std::tuple<int, int>> out(tuples->size());
+            return nanosPerOp(out.size(), [&] { generator.fill(out.data(), out.size()); });
+        }});
+        return suite;
+    }
+
+    // ---- statistics ----
+
+    double mean(const Samples& samples) {
+        double sum = 0;
+        for (double s : samples) {
+            sum += s;
+        }
+        return sum / samples.size();
+    }
+
+    double variance(const Samples& samples) {
+        if (samples.size() < 2) {
+            return 0;
+        }
+        double m = mean(samples);
+        double sum = 0;
+        for (double s : samples) {
+            sum += (s - m) * (s - m);
+        }
+        return sum / (samples.size() - 1);
+    }
+
+    // Continued fraction for the regularized incomplete beta function (modified Lentz)
+    double betaContinuedFraction(double a, double b, double x) {
+        const double tiny = 1e-300;
+        double c = 1;
+        double d = 1 - (a + b) * x / (a + 1);
+        d = 1 / (std::abs(d) < tiny ? tiny : d);
+        double h = d;
+        for (int m = 1; m <= 300; ++m) {
+            double aa = m * (b - m) * x / ((a + 2 * m - 1) * (a + 2 * m));
+            d = 1 + aa * d;
+            d = 1 / (std::abs(d) < tiny ? tiny : d);
+            c = 1 + aa / c;
+            c = std::abs(c) < tiny ? tiny : c;
+            h *= d * c;
+            aa = -(a + m) * (a + b + m) * x / ((a + 2 * m) * (a + 2 * m + 1));
+            d = 1 + aa * d;
+            d = 1 / (std::abs(d) < tiny ? tiny : d);
+            c = 1 + aa / c;
+            c = std::abs(c) < tiny ? tiny : c;
+            double delta = d * c;
+            h *= delta;
+            if (std::abs(delta - 1) < 1e-12) {
+                break;
+            }
+        }
+        return h;
+    }
+
+    double incompleteBeta(double a, double b, double x) {
+        if (x <= 0) {
+            return 0;
+        }
+        if (x >= 1) {
+            return 1;
+        }
+        double front = std::exp(std::lgamma(a + b) - std::lgamma(a) - std::lgamma(b) + a * std::log(x) +
+                                b * std::log(1 - x));
+        if (x < (a + 1) / (a + b + 2)) {
+            return front * betaContinuedFraction(a, b, x) / a;
+        }
+        return 1 - front * betaContinuedFraction(b, a, 1 - x) / b;
+    }
+
+    // P(T > t) for Student's t with df degrees of freedom
+    double studentUpperTail(double t, double df) {
+        double tail = 0.5 * incompleteBeta(df / 2, 0.5, df / (df + t * t));
+        return t > 0 ? tail : 1 - tail;
+    }
+
+    // Two-sided 95% quantile of Student's t, by bisection on the tail
+    double studentQuantile95(double df) {
+        double lo = 0;
+        double hi = 100;
+        for (int i = 0; i < 100; ++i) {
+            double mid = (lo + hi) / 2;
+            (studentUpperTail(mid, df) > 0.025 ? lo : hi) = mid;
+        }
+        return (lo + hi) / 2;
+    }
+
+    struct Comparison {
+        double change;  // relative change of the mean, current vs baseline
+        double low;     // 95% confidence interval of the change
+        double high;
+        double pSlower; // one-sided Welch p-value for "current is slower"
+    };
+
+    Comparison compare(const Samples& baseline, const Samples& current) {
+        double m0 = mean(baseline);
+        double m1 = mean(current);
+        double v0 = variance(baseline) / baseline.size();
+        double v1 = variance(current) / current.size();
+        double se = std::sqrt(v0 + v1);
+        Comparison result;
+        result.change = (m1 - m0) / m0;
+        if (se == 0) {
+            result.low = result.high = result.change;
+            result.pSlower = m1 > m0 ? 0 : 1;
+            return result;
+        }
+        // Welch-Satterthwaite degrees of freedom
+        double df = (v0 + v1) * (v0 + v1) /
+                    (v0 * v0 / std::max<size_t>(1, baseline.size() - 1) + v1 * v1 / std::max<size_t>(1, current.size() - 1));
+        double t = (m1 - m0) / se;
+        double margin = studentQuantile95(df) * se;
+        result.low = (m1 - m0 - margin) / m0;
+        result.high = (m1 - m0 + margin) / m0;
+        result.pSlower = studentUpperTail(t, df);
+        return result;
+    }
+
+    // ---- baseline files ----
+
+    std::string defaultProfile() {
+        std::string model = "unknown-cpu";
+        std::ifstream cpuinfo("/proc/cpuinfo");
+        std::string line;
+        while (std::getline(cpuinfo, line)) {
+            if (line.compare(0, 10, "model name") == 0) {
+                model = line.substr(line.find(':') + 1);
+                break;
+            }
+        }
+        std::ostringstream profile;
+        profile << model << "-" << std::thread::hardware_concurrency() << "t";
+#if defined(__clang__)
+        profile << "-clang" << __clang_major__;
+#elif defined(__GNUC__)
+        profile << "-gcc" << __GNUC__;
+#endif
+#ifdef NDEBUG
+        profile << "-ndebug";
+#else
+        profile << "-debug";
+#endif
+        // Keep it usable as a file name
+        std::string name;
+        for (char c : profile.str()) {
+            if (std::isalnum(static_cast<unsigned char>(c)) || c == '-' || c == '_' || c == '.') {
+                name += c;
+            } else if (!name.empty() && name.back() != '_') {
+                name += '_';
+            }
+        }
+        return name.empty() ? "default" : name;
+    }
+
+    bool writeBaseline(const std::string& path, const std::string& profile, const std::map<std::string, Samples>& results) {
+        std::ofstream out(path);
+        if (!out) {
+            return false;
+        }
+        out << "{\n  \"profile\": \"" << profile << "\",\n  \"seed\": " << options.seed
+            << ",\n  \"unit\": \"ns/op\",\n  \"benchmarks\": {";
+        bool first = true;
+        for (const auto& entry : results) {
+            out << (first ? "\n" : ",\n") << "    \"" << entry.first << "\": [";
+            for (size_t i = 0; i < entry.second.size(); ++i) {
+                out << (i ? ", " : "") << std::setprecision(9) << entry.second[i];
+            }
+            out << "]";
+            first = false;
+        }
+        out << "\n  }\n}\n";
+        return static_cast<bool>(out);
+    }
+
+    // Reads the "benchmarks" object written by writeBaseline: string keys mapping to arrays of numbers
+    bool readBaseline(const std::string& path, std::map<std::string, Samples>& results) {
+        std::ifstream in(path);
+        if (!in) {
+            return false;
+        }
+        std::stringstream buffer;
+        buffer << in.rdbuf();
+        const std::string text = buffer.str();
+        size_t pos = text.find("\"benchmarks\"");
+        if (pos == std::string::npos || (pos = text.find('{', pos)) == std::string::npos) {
+            return false;
+        }
+        for (;;) {
+            size_t keyStart = text.find_first_of("\"}", pos + 1);
+            if (keyStart == std::string::npos || text[keyStart] == '}') {
+                return true;
+            }
+            size_t keyEnd = text.find('"', keyStart + 1);
+            size_t open = text.find('[', keyEnd);
+            size_t close = text.find(']', open);
+            if (keyEnd == std::string::npos || open == std::string::npos || close == std::string::npos) {
+                return false;
+            }
+            Samples& samples = results[text.substr(keyStart + 1, keyEnd - keyStart - 1)];
+            std::string values = text.substr(open + 1, close - open - 1);
+            std::replace(values.begin(), values.end(), ',', ' ');
+            std::istringstream numbers(values);
+            double value;
+            while (numbers >> value) {
+                samples.push_back(value);
+            }
+            pos = close;
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    if (!options.parse(argc, argv)) {
+        return 1;
+    }
+    std::string mode = "compare";
+    std::string profile = defaultProfile();
+    std::string baselineDir = "perf";
+    int runs = 10;
+    double threshold = 5;  // percent
+    double alpha = 0.01;
+    const std::vector<std::string>& args = options.positional;
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string& arg = args[i];
+        std::string value;
+        auto flag = [&](const char* name) {
+            const std::string prefix = std::string(name) + "=";
+            if (arg.compare(0, prefix.size(), prefix) == 0) {
+                value = arg.substr(prefix.size());
+                return true;
+            }
+            if (arg == name && i + 1 < args.size()) {
+                value = args[++i];
+                return true;
+            }
+            return false;
+        };
+        if (arg == "record" || arg == "compare") {
+            mode = arg;
+        } else if (flag("--profile")) {
+            profile = value;
+        } else if (flag("--baseline-dir")) {
+            baselineDir = value;
+        } else if (flag("--runs")) {
+            runs = std::max(2, std::atoi(value.c_str()));
+        } else if (flag("--threshold")) {
+            threshold = std::atof(value.c_str());
+        } else if (flag("--alpha")) {
+            alpha = std::atof(value.c_str());
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            return 1;
+        }
+    }
+    if (!options.pinCurrentThread()) {
+        std::cerr << "Could not pin to CPU " << options.pinCpu << std::endl;
+    }
+    options.log(std::cout);
+    const std::string path = baselineDir + "/" + profile + ".json";
+    std::cout << "Profile: " << profile << " (" << path << "), " << runs << " runs per benchmark" << std::endl;
+
+    std::map<std::string, Samples> baseline;
+    if (mode == "compare" && !readBaseline(path, baseline)) {
+        std::cerr << "No baseline for this profile; record one with: perfgate record --baseline-dir " << baselineDir
+                  << std::endl;
+        return 2;
+    }
+
+    // Repetitions are interleaved across benchmarks so slow drift (thermal, background load) hits all of them alike
+    std::vector<Benchmark> suite = makeSuite();
+    std::map<std::string, Samples> results;
+    for (int w = 0; w < options.warmupRuns; ++w) {
+        for (const Benchmark& benchmark : suite) {
+            benchmark.run();
+        }
+    }
+    for (int r = 0; r < runs; ++r) {
+        for (const Benchmark& benchmark : suite) {
+            results[benchmark.name].push_back(benchmark.run());
+        }
+    }
+
+    if (mode == "record") {
+        std::error_code error;
+        std::filesystem::create_directories(baselineDir, error);
+        if (!writeBaseline(path, profile, results)) {
+            std::cerr << "Could not write " << path << std::endl;
+            return 1;
+        }
+        for (const auto& entry : results) {
+            std::cout << std::fixed << std::setprecision(2) << std::setw(22) << entry.first
+                      << std::setw(12) << mean(entry.second) << " ns/op" << std::endl;
+        }
+        std::cout << "Baseline written to " << path << std::endl;
+        return 0;
+    }
+
+    std::cout << std::setw(22) << "Benchmark" << std::setw(12) << "Base ns/op" << std::setw(12) << "Now ns/op"
+              << std::setw(10) << "Change" << std::setw(22) << "95% CI" << std::setw(10) << "p(slower)"
+              << "  Verdict" << std::endl;
+    int regressions = 0;
+    for (const auto& entry : results) {
+        auto it = baseline.find(entry.first);
+        if (it == baseline.end() || it->second.size() < 2) {
+            std::cout << std::setw(22) << entry.first << "  (not in baseline)" << std::endl;
+            continue;
+        }
+        Comparison c = compare(it->second, entry.second);
+        const char* verdict = "ok";
+        if (c.change * 100 > threshold && c.pSlower < alpha) {
+            verdict = "REGRESSION";
+            regressions++;
+        } else if (c.change * 100 < -threshold && 1 - c.pSlower < alpha) {
+            verdict = "faster";
+        }
+        std::ostringstream interval;
+        interval << std::fixed << std::setprecision(1) << "[" << c.low * 100 << "%, " << c.high * 100 << "%]";
+        std::cout << std::fixed << std::setprecision(2) << std::setw(22) << entry.first
+                  << std::setw(12) << mean(it->second) << std::setw(12) << mean(entry.second)
+                  << std::setprecision(1) << std::setw(9) << c.change * 100 << "%" << std::setw(22) << interval.str()
+                  << std::setprecision(4) << std::setw(10) << c.pSlower << "  " << verdict << std::endl;
+    }
+    std::cout << std::setprecision(1) << regressions << " regression(s) beyond " << threshold << "% at alpha " << std::setprecision(3) << alpha << std::endl;
+    return regressions > 0 ? 1 : 0;
+}